@@ -18,6 +18,7 @@
 #include "src/core/subject.h"
 #include "src/core/utils.h"
 #include "src/database/databasecomponent.h"
+#include "src/database/syncengine.h"
 #include "src/network/requesthttp.h"
 #include "src/notification/notificationhandle.h"
 
@@ -91,6 +92,8 @@ int main(int argc, char *argv[])
     // register custom types to be used by plugins
     qmlRegisterType<RequestHttp>("RequestHttp", 1, 0, "RequestHttp");
     qmlRegisterType<DatabaseComponent>("Database", 1, 0, "Database");
+    qmlRegisterUncreatableType<TableModel>("Database", 1, 0, "TableModel", QStringLiteral("TableModel is created by Database component"));
+    qmlRegisterType<SyncEngine>("Database", 1, 0, "SyncEngine");
     qmlRegisterType<Observer>("Observer", 1, 0, "Observer");
 
     // register the Awesome icon font loader as QML singleton type
@@ -1,13 +1,73 @@
 #include "plugindatabasetablecreator.h"
 #include "../database/database.h"
 
-PluginDatabaseTableCreator::PluginDatabaseTableCreator(const QString &pluginSqlFilePath, QObject *parent) : QThread(parent)
+PluginDatabaseTableCreator::PluginDatabaseTableCreator(QObject *parent) : QThread(parent)
 {
     _database = Database::instance();
-    _pluginSqlFilePath = pluginSqlFilePath;
+    _database->addDedicatedThread(this);
+}
+
+void PluginDatabaseTableCreator::addPlugin(const QString &pluginName, const QString &pluginDirPath, const QStringList &dependencies, const QVariantMap &searchColumns, const QVariantMap &jsonIndexes, const QVariantMap &cborColumns)
+{
+    _pluginsPaths.insert(pluginName, pluginDirPath);
+    _dependencies.insert(pluginName, dependencies);
+    _searchColumns.insert(pluginName, searchColumns);
+    _jsonIndexes.insert(pluginName, jsonIndexes);
+    _cborColumns.insert(pluginName, cborColumns);
+}
+
+QStringList PluginDatabaseTableCreator::sortedPlugins() const
+{
+    QStringList visiting;
+    QStringList sorted;
+    // QMap keys are sorted by name, so the order is the same in each execution
+    foreach (const QString &pluginName, _pluginsPaths.keys())
+        visit(pluginName, &visiting, &sorted);
+    return sorted;
+}
+
+void PluginDatabaseTableCreator::visit(const QString &pluginName, QStringList *visiting, QStringList *sorted) const
+{
+    if (sorted->contains(pluginName) || !_pluginsPaths.contains(pluginName))
+        return;
+    if (visiting->contains(pluginName)) {
+        emit _database->logMessage(QStringLiteral("Circular database dependency found in plugin: ") + pluginName);
+        return;
+    }
+    visiting->append(pluginName);
+    foreach (const QString &dependency, _dependencies.value(pluginName))
+        visit(dependency, visiting, sorted);
+    visiting->removeOne(pluginName);
+    sorted->append(pluginName);
 }
 
 void PluginDatabaseTableCreator::run()
 {
-    _database->createTable(_pluginSqlFilePath);
+    QStringList failed;
+    foreach (const QString &pluginName, sortedPlugins()) {
+        // if some dependency was not migrated, the plugin migrations can fail too
+        bool hasFailedDependency = false;
+        foreach (const QString &dependency, _dependencies.value(pluginName))
+            hasFailedDependency = hasFailedDependency || failed.contains(dependency);
+        if (hasFailedDependency || !_database->migrate(pluginName, _pluginsPaths.value(pluginName))) {
+            failed << pluginName;
+            continue;
+        }
+        // the indexes and the CBOR conversion needs the migrated tables
+        QMap<QString, QVariant> searchColumns(_searchColumns.value(pluginName));
+        QMap<QString, QVariant>::const_iterator i = searchColumns.constBegin();
+        for (; i != searchColumns.constEnd(); ++i)
+            _database->createSearchIndex(i.key(), i.value().toStringList());
+        QMap<QString, QVariant> jsonIndexes(_jsonIndexes.value(pluginName));
+        for (i = jsonIndexes.constBegin(); i != jsonIndexes.constEnd(); ++i) {
+            foreach (const QString &jsonPath, i.value().toStringList())
+                _database->createJsonIndex(i.key(), jsonPath);
+        }
+        QMap<QString, QVariant> cborColumns(_cborColumns.value(pluginName));
+        for (i = cborColumns.constBegin(); i != cborColumns.constEnd(); ++i)
+            _database->setCborColumns(i.key(), i.value().toStringList());
+    }
+    if (!failed.isEmpty())
+        emit _database->logMessage(QStringLiteral("The database migrations failed for plugins: ") + failed.join(QStringLiteral(", ")));
+    _database->setSchemaReady(true);
 }
@@ -1,16 +1,26 @@
 #ifndef PLUGINDATABASETABLECREATOR_H
 #define PLUGINDATABASETABLECREATOR_H
 
+#include <QMap>
+#include <QStringList>
 #include <QThread>
+#include <QVariantMap>
 
 class Database;
 
 /**
  * @brief The PluginDatabaseCreator class
  * @extends QThread
- * This class create a plugin database table in application SQLITE database, executing in background thread.
- * The table file can contains a table creation or update rules.
- * A instance of this class is created for each plugin that contains the 'plugin_table.sql' file.
+ * This class apply the plugins database migrations in application SQLITE database, executing in background thread.
+ * The 'plugin_table.sql' file is the first version and the files in 'migrations' directory are the next versions.
+ * A single instance of this class is created by PluginManager, and each plugin that contains the 'plugin_table.sql' file
+ * or the 'migrations' directory is added with addPlugin. The plugins are migrated one by one (never concurrently),
+ * and a plugin is migrated after the plugins listed in your "dependencies" (from plugin config.json).
+ * After the migrations, the full text search indexes and the json paths indexes of the plugin tables are created or updated
+ * (see Database::createSearchIndex and Database::createJsonIndex),
+ * and the existing rows of the tables with CBOR columns are converted (see Database::setCborColumns).
+ * While the thread is running, Database::isSchemaReady() return false, and the Database::schemaReady signal
+ * is emitted after all plugins are migrated.
  */
 class PluginDatabaseTableCreator : public QThread
 {
@@ -18,10 +28,29 @@ class PluginDatabaseTableCreator : public QThread
 public:
     /**
      * @brief PluginDatabaseCreator
-     * @param pluginSqlFilePath QString a string with absolute path to 'plugin_table.sql' file
      * @param parent QObject* the parent of this instance
      */
-    PluginDatabaseTableCreator(const QString &pluginSqlFilePath, QObject *parent = nullptr);
+    explicit PluginDatabaseTableCreator(QObject *parent = nullptr);
+
+    /**
+     * @brief addPlugin
+     * Add a plugin to be migrated. Needs to be called before start the thread.
+     * @param pluginName QString the plugin name, used to save the applied migration version
+     * @param pluginDirPath QString a string with absolute path to plugin directory
+     * @param dependencies QStringList the plugins names that needs to be migrated before this plugin
+     * @param searchColumns QVariantMap the tables to create a full text search index, as table_name -> list of columns
+     * @param jsonIndexes QVariantMap the json paths to create a index, as table_name -> list of json paths
+     * @param cborColumns QVariantMap the columns saved as CBOR, as table_name -> list of columns
+     */
+    void addPlugin(const QString &pluginName, const QString &pluginDirPath, const QStringList &dependencies = QStringList(), const QVariantMap &searchColumns = QVariantMap(), const QVariantMap &jsonIndexes = QVariantMap(), const QVariantMap &cborColumns = QVariantMap());
+
+    /**
+     * @brief sortedPlugins
+     * Return the plugins names sorted by dependencies: each plugin is after your dependencies.
+     * The unknown dependencies are ignored and a circular dependency is broken by the plugin name order.
+     * @return QStringList
+     */
+    QStringList sortedPlugins() const;
 
 protected:
     /**
@@ -32,9 +61,23 @@ protected:
      */
     void run() override;
 
+private:
+    /**
+     * @brief visit
+     * Append the 'pluginName' dependencies and the 'pluginName' to 'sorted' (a depth first search).
+     * @param pluginName QString the plugin name
+     * @param visiting QStringList* the plugins in the current search path, used to detect circular dependencies
+     * @param sorted QStringList* the sorted plugins names
+     */
+    void visit(const QString &pluginName, QStringList *visiting, QStringList *sorted) const;
+
 private:
     Database *_database;
-    QString _pluginSqlFilePath;
+    QMap<QString, QString> _pluginsPaths;
+    QMap<QString, QStringList> _dependencies;
+    QMap<QString, QVariantMap> _searchColumns;
+    QMap<QString, QVariantMap> _jsonIndexes;
+    QMap<QString, QVariantMap> _cborColumns;
 };
 
 #endif // PLUGINDATABASETABLECREATOR_H
@@ -2,6 +2,7 @@
 #include "plugindatabasetablecreator.h"
 #include "settings.h"
 #include "utils.h"
+#include "../database/database.h"
 
 #include <QApplication>
 #include <QDebug>
@@ -16,6 +17,7 @@
 #endif
 
 PluginManager::PluginManager(QObject *parent) : QObject(parent)
+  ,m_tableCreator(nullptr)
 {
 }
 
@@ -62,6 +64,9 @@ void PluginManager::loadPlugins()
     // 3: On other platforms, the default is a empty string (linux desktop).
     QString applicationVersion(QApplication::applicationVersion());
 
+    // the attached databases are not saved, so needs to be attached on each execution
+    attachSeedDatabases(pluginsDirPath, pluginsDirs);
+
     // if the application is not running in DEBUG mode
     // the plugins will be reloaded only if the application are updated
 #ifndef QT_DEBUG
@@ -107,11 +112,20 @@ void PluginManager::loadPlugins()
                     #endif
                 }
             }
-            createDatabaseTables(pluginAbsPath);
+            createDatabaseTables(pluginAbsPath, pluginJson);
             parsePages(pluginAbsPath, pluginJson);
         }
     }
 
+    // apply all plugins migrations in background thread. While running,
+    // the DatabaseComponent objects wait for the schemaReady signal to load your tables
+    if (m_tableCreator) {
+        Database::instance()->setSchemaReady(false);
+        connect(m_tableCreator, &QThread::finished, m_tableCreator, &QObject::deleteLater);
+        m_tableCreator->start();
+        m_tableCreator = nullptr;
+    }
+
     sortPages();
     save();
 }
@@ -166,18 +180,29 @@ void PluginManager::clearCache()
     m_settings->remove(QStringLiteral("version"));
 }
 
-void PluginManager::createDatabaseTables(const QString &pluginDirPath)
+void PluginManager::createDatabaseTables(const QString &pluginDirPath, const QVariantMap &pluginConfig)
 {
-    if (!QFile::exists(pluginDirPath + QStringLiteral("/plugin_table.sql")))
+    if (!QFile::exists(pluginDirPath + QStringLiteral("/plugin_table.sql")) && !QFile::exists(pluginDirPath + QStringLiteral("/migrations")))
         return;
 
     #ifdef QT_DEBUG
         qDebug() << QStringLiteral("Found a a sql file for %1 plugin").arg(pluginDirPath);
     #endif
 
-    auto *worker = new PluginDatabaseTableCreator(pluginDirPath + QStringLiteral("/plugin_table.sql"), this);
-    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
-    worker->start();
+    // only the pending migrations are applied. The plugin directory name is the plugin name
+    if (!m_tableCreator)
+        m_tableCreator = new PluginDatabaseTableCreator(this);
+    m_tableCreator->addPlugin(QFileInfo(pluginDirPath).fileName(), pluginDirPath, pluginConfig.value(QStringLiteral("dependencies")).toStringList(), pluginConfig.value(QStringLiteral("searchColumns")).toMap(), pluginConfig.value(QStringLiteral("jsonIndexes")).toMap(), pluginConfig.value(QStringLiteral("cborColumns")).toMap());
+}
+
+void PluginManager::attachSeedDatabases(const QString &pluginsDirPath, const QStringList &pluginsDirs)
+{
+    Database *database = Database::instance();
+    foreach (const QString &pluginDirName, pluginsDirs) {
+        QString seedFilePath(pluginsDirPath + pluginDirName + QStringLiteral("/seed.db"));
+        if (QFile::exists(seedFilePath))
+            database->attachSeedDatabase(pluginDirName.toLower(), seedFilePath);
+    }
 }
 
 void PluginManager::sortPages()
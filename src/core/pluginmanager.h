@@ -15,6 +15,7 @@ class PluginDatabaseTableCreator;
  *  in android, will be placed in assets:/plugins/;
  *  in ios/osx will be placed in assets_catalogs:/plugins/.
  * 2: Handle the plugins database table criation, if any of the plugins has a 'plugin_table.sql' file in your directory.
+ *    The tables are created in a single background thread, and Database emit the schemaReady signal when finished.
  * 3: Handle all plugins and application files cache deletion, when application are updated.
  * 4: When load all plugins, save in local settings the plugins pages list, to be used by follow QML components:
  *      Navigation Drawer menu retrieve the 'pages' list to show the options to the user;
@@ -112,12 +113,26 @@ private:
 
     /**
      * @brief createDatabaseTables
-     * Search for 'plugin_table.sql' file in 'pluginDirPath'.
-     * If a file with name 'plugin_table.sql' exists, will be loaded and pass to execute as sql query
-     * in Database object and the table (or any sql query in the file) will be executed.
+     * Search for 'plugin_table.sql' file or 'migrations' directory in 'pluginDirPath'.
+     * If exists, the plugin is added to the PluginDatabaseTableCreator thread, started after read all plugins,
+     * that apply the pending migrations of each plugin using Database::migrate(...).
+     * The plugins listed in "dependencies" property of the plugin config.json are migrated first.
+     * The tables in "searchColumns" property, like {"messages": ["title", "body"]}, receive a full text search index,
+     * and the json paths in "jsonIndexes" property, like {"messages": ["sender.id"]}, receive a expression index.
+     * The columns in "cborColumns" property, like {"messages": ["payload"]}, are saved as CBOR instead of json text.
      * @param pluginDirPath QString a string with some plugin directory path
+     * @param pluginConfig QVariantMap the plugin config.json content
      */
-    void createDatabaseTables(const QString &pluginDirPath);
+    void createDatabaseTables(const QString &pluginDirPath, const QVariantMap &pluginConfig);
+
+    /**
+     * @brief attachSeedDatabases
+     * Attach the 'seed.db' file of each plugin (if exists) as a read-only schema named with the plugin name,
+     * using Database::attachSeedDatabase. The seed files are attached on each application start, even if the plugins are not reloaded.
+     * @param pluginsDirPath QString the plugins root directory path, with a slash at the end
+     * @param pluginsDirs QStringList the plugins directories names
+     */
+    void attachSeedDatabases(const QString &pluginsDirPath, const QStringList &pluginsDirs);
 
     /**
      * @brief sortPages
@@ -170,6 +185,13 @@ private:
      * This pointer is needed to access, ready and write in application settings (QSettings)
      */
     Settings *m_settings;
+
+    /**
+     * @brief m_tableCreator
+     * The single thread that apply the plugins migrations, one plugin at a time.
+     * Is created by createDatabaseTables if some plugin has migrations.
+     */
+    PluginDatabaseTableCreator *m_tableCreator;
 };
 
 #endif // PLUGINMANAGER_H
@@ -1,38 +1,111 @@
 #include "asyncselect.h"
 #include "database.h"
+#include "resultcache.h"
 
+#include <QElapsedTimer>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QSqlQuery>
+#include <QSqlRecord>
 
-AsyncSelect::AsyncSelect(const QString &tableName, const QStringList &jsonColumns, const QVariantMap &where, const QVariantMap &args, QObject *parent) :
-    QThread(parent), m_tableName(tableName), m_jsonColumns(jsonColumns), m_where(where), m_args(args)
+AsyncSelect::AsyncSelect(const QString &tableName, const QStringList &jsonColumns, const QVariantMap &where, const QVariantMap &args, int chunkSize, QObject *parent) :
+    QObject(parent), m_tableName(tableName), m_jsonColumns(jsonColumns), m_where(where), m_args(args), m_chunkSize(qMax(1, chunkSize))
 {
     m_database = Database::instance();
+    setAutoDelete(false);
+}
+
+void AsyncSelect::cancel()
+{
+    m_canceled.store(1);
+}
+
+bool AsyncSelect::isCanceled() const
+{
+    return m_canceled.load() == 1;
+}
+
+void AsyncSelect::setCacheKey(const QString &cacheKey)
+{
+    m_cacheKey = cacheKey;
 }
 
 void AsyncSelect::run()
 {
-    if (m_tableName.isEmpty())
-        return;
-    QVariantList result(m_database->select(m_tableName, m_where, m_args));
-    int resultSize = result.size();
-    if (!resultSize)
+    QElapsedTimer timer;
+    timer.start();
+
+    // the generation is read before the query, so the rows read before some table change are not cached
+    ResultCache *resultCache = m_database->resultCache();
+    bool isCacheable = !m_cacheKey.isEmpty();
+    int generation = isCacheable ? resultCache->generation(m_tableName) : 0;
+    int maxCacheCost = isCacheable ? resultCache->maxSize() / 4 : 0;
+    int cacheCost = 0;
+    ResultCache::Entry cacheEntry;
+
+    QSqlQuery *sqlQuery = nullptr;
+    if (!m_tableName.isEmpty() && !isCanceled()) {
+        // the "search" argument is a full text search in the rows filtered by 'where', ordered by relevance (see Database::search)
+        if (m_args.contains(QStringLiteral("search")))
+            sqlQuery = m_database->searchCursor(m_tableName, m_args.value(QStringLiteral("search")).toString(), m_where, m_args);
+        else
+            sqlQuery = m_database->selectCursor(m_tableName, m_where, m_args);
+    }
+    if (!sqlQuery) {
+        emit runFinished();
         return;
+    }
+
+    bool isMetaKeyValue = m_args.value(QStringLiteral("selectType")).toInt() == Database::Meta_Key_Value_Int;
+    bool isKeyset = m_args.contains(QStringLiteral("after")) || m_args.contains(QStringLiteral("before"));
+    QString pkColumn(isKeyset ? m_database->pkColumn(m_args) : QString());
+    QVariant firstPk;
+    QVariant lastPk;
+    int i = 0;
+    int total = 0;
+    int totalColumns = 0;
+    QSqlRecord record;
     QVariantMap map;
+    QVariantList items;
     QJsonDocument json;
     QJsonParseError jsonParseError;
-    // iterate in all entries to parse json objects if exists
-    for (int i = 0; i < resultSize; ++i) {
-        map = result[i].toMap();
+    QByteArray jsonValue;
+    items.reserve(m_chunkSize);
+
+    // the caller can decode only the json columns that will be read, using the "jsonColumns" argument
+    QStringList jsonColumns(m_jsonColumns);
+    if (m_args.contains(QStringLiteral("jsonColumns")))
+        jsonColumns = m_args.value(QStringLiteral("jsonColumns")).toStringList();
+
+    // read the rows from the statement, sending each chunk of 'm_chunkSize' rows
+    while (!isCanceled() && sqlQuery->next()) {
+        record = sqlQuery->record();
+        totalColumns = record.count();
+        if (!isMetaKeyValue)
+            map.clear();
+        for (i = 0; i < totalColumns; ++i) {
+            if (isMetaKeyValue)
+                map.insert(sqlQuery->value(0).toString(), sqlQuery->value(1));
+            else
+                map.insert(record.fieldName(i), Database::decodeValue(sqlQuery->value(i)));
+        }
+
         // iterate the map to try parse property to object or array
         // if was saved as string. This is needed to qml receive as array or object
         // and prevent qml objects to make JSON.parse(...)
         // JSON.parse can't parse deep json arrays or objects!
-        foreach (const QString &key, m_jsonColumns) {
+        foreach (const QString &key, jsonColumns) {
+            // the column can be not selected (see the "columns" arg)
+            if (!map.contains(key))
+                continue;
+            // only a object or array is parsed, the plain strings, numbers and null values are not
+            jsonValue = map.value(key).toByteArray();
+            if (!Database::isJsonDocument(jsonValue))
+                continue;
             // try create a json document if data type is a valid json (from a string),
-            // otherwise (is a plain string or number) continue to next key
-            json = QJsonDocument::fromJson(map[key].toByteArray(), &jsonParseError);
+            // otherwise continue to next key
+            json = QJsonDocument::fromJson(jsonValue, &jsonParseError);
             if (jsonParseError.error == QJsonParseError::NoError) {
                 if (json.isObject() && !json.isEmpty())
                     map.insert(key, json.object().toVariantMap());
@@ -40,6 +113,49 @@ void AsyncSelect::run()
                     map.insert(key, json.array().toVariantList());
             }
         }
-        emit itemLoaded(map);
+
+        if (isKeyset) {
+            if (!total)
+                firstPk = map.value(pkColumn);
+            lastPk = map.value(pkColumn);
+        }
+
+        items << map;
+        ++total;
+        if (isCacheable) {
+            // the maps are implicitly shared with the emitted chunks
+            cacheCost += ResultCache::estimateSize(map);
+            isCacheable = cacheCost <= maxCacheCost;
+            if (isCacheable)
+                cacheEntry.items << map;
+            else
+                cacheEntry.items.clear();
+        }
+        if (items.size() == m_chunkSize) {
+            emit itemsLoaded(items);
+            items.clear();
+        }
+    }
+
+    // the select time includes the time to read all rows
+    if (!isCanceled())
+        m_database->profileQuery(sqlQuery, timer.nsecsElapsed(), total);
+
+    // reset the statement to release the read lock
+    sqlQuery->finish();
+
+    if (!isCanceled()) {
+        if (!items.isEmpty())
+            emit itemsLoaded(items);
+        if (isKeyset) {
+            QVariantMap tokens(Database::pageTokens(m_args, total, firstPk, lastPk));
+            cacheEntry.previous = tokens.value(QStringLiteral("previous")).toString();
+            cacheEntry.next = tokens.value(QStringLiteral("next")).toString();
+            emit pageLoaded(cacheEntry.previous, cacheEntry.next);
+        }
+        if (isCacheable)
+            resultCache->insert(m_tableName, m_cacheKey, cacheEntry, generation, cacheCost);
+        emit selectFinished(total, timer.elapsed());
     }
+    emit runFinished();
 }
@@ -1,8 +1,10 @@
 #ifndef ASYNCSELECT_H
 #define ASYNCSELECT_H
 
+#include <QAtomicInt>
+#include <QObject>
+#include <QRunnable>
 #include <QVariant>
-#include <QThread>
 
 class Database;
 
@@ -10,9 +12,13 @@ class Database;
  * @brief The AsyncSelect class
  * Execute a asynchronous selection in SQLITE database, using 'tableName', 'where' condition and 'args' as selection properties, like 'LIMIT' and 'OFFSET'.
  * The jsonColumns is needed if the table contains columns with serialized json strings, to the value are returned as QVariant(Map/List).
- * To retrieve the result set, the pointer send a 'itemLoaded' signal for each entry, with a QVariantMap as column_name->value.
+ * To retrieve the result set, the pointer send a 'itemsLoaded' signal for each chunk of 'chunkSize' entries, with a QVariantList
+ * of QVariantMap as column_name->value. After read all rows, the 'selectFinished' signal is sent with the total of rows and the elapsed time.
+ * The selection can be stopped calling 'cancel()', and no more chunks will be sent.
+ * The object is a QRunnable executed by the QueryExecutor thread pool, and is not deleted by the pool.
+ * The 'runFinished' signal is always sent at the end of the execution and can be used to delete the object.
  */
-class AsyncSelect : public QThread
+class AsyncSelect : public QObject, public QRunnable
 {
     Q_OBJECT
 public:
@@ -22,28 +28,71 @@ public:
      * @param jsonColumns QStringList a list of columns names that has serialized json string to parse for map or array
      * @param where QVariantMap a map with columns_name->value to build the query filter condition
      * @param args the selection args to customize the query predicates
+     * @param chunkSize int the number of rows sent in each 'itemsLoaded' signal
      * @param parent QObject* the object parent
      */
-    explicit AsyncSelect(const QString &tableName, const QStringList &jsonColumns, const QVariantMap &where, const QVariantMap &args, QObject *parent = nullptr);
+    explicit AsyncSelect(const QString &tableName, const QStringList &jsonColumns, const QVariantMap &where, const QVariantMap &args, int chunkSize = 200, QObject *parent = nullptr);
+
+    /**
+     * @brief cancel
+     * Request the worker to stop the selection. The worker check the request before read each row,
+     * and after canceled, the 'itemsLoaded' and 'selectFinished' signals are not emitted.
+     */
+    void cancel();
 
-signals:
     /**
-     * @brief itemLoaded
-     * This signal will be emitted after load some database data (from select method).
-     * @param data QVariantMap a map with column_name->value loaded from database.
+     * @brief isCanceled
+     * Return true if cancel() was called
+     * @return bool
      */
-    void itemLoaded(const QVariantMap &data);
+    bool isCanceled() const;
+
+    /**
+     * @brief setCacheKey
+     * Set the key (see Database::resultCacheKey) to save the rows in the ResultCache after read all rows.
+     * If the key is empty or the rows are bigger than a quarter of the cache, the rows are not saved.
+     * @param cacheKey QString
+     */
+    void setCacheKey(const QString &cacheKey);
 
-protected:
     /**
      * @brief run
      * @overload
-     * The start point for the thread.
-     * After call the thread->start(), the newly created thread calls this function.
+     * The start point for the task, called by some thread from the QueryExecutor thread pool.
      * @return void
      */
     void run() override;
 
+signals:
+    /**
+     * @brief itemsLoaded
+     * This signal will be emitted for each 'chunkSize' rows loaded from database (and once for the remaining rows).
+     * @param items QVariantList a list of QVariantMap with column_name->value loaded from database.
+     */
+    void itemsLoaded(const QVariantList &items);
+
+    /**
+     * @brief selectFinished
+     * This signal will be emitted after all rows are loaded, if the selection was not canceled.
+     * @param total int the total of rows loaded
+     * @param elapsedMs qint64 the time spent in the selection in milliseconds
+     */
+    void selectFinished(int total, qint64 elapsedMs);
+
+    /**
+     * @brief pageLoaded
+     * This signal will be emitted before 'selectFinished' when the selection uses keyset pagination ("after" or "before" args).
+     * @param previous QString the token to load the previous page, or a empty string if is the first page
+     * @param next QString the token to load the next page, or a empty string if is the last page
+     */
+    void pageLoaded(const QString &previous, const QString &next);
+
+    /**
+     * @brief runFinished
+     * This signal will be emitted at the end of run(), even if the selection was canceled or fails.
+     */
+    void runFinished();
+
 private:
     /**
      * @brief m_tableName
@@ -58,6 +107,12 @@ private:
      */
     QStringList m_jsonColumns;
 
+    /**
+     * @brief m_cacheKey
+     * The key to save the rows in the ResultCache, or a empty string to not save
+     */
+    QString m_cacheKey;
+
     /**
      * @brief m_where
      * The predicates filter as object (javascript from QML),
@@ -72,6 +127,18 @@ private:
      */
     QVariantMap m_args;
 
+    /**
+     * @brief m_chunkSize
+     * The number of rows sent in each 'itemsLoaded' signal
+     */
+    int m_chunkSize;
+
+    /**
+     * @brief m_canceled
+     * Set to 1 by cancel() to stop the selection
+     */
+    QAtomicInt m_canceled;
+
     /**
      * @brief m_database
      * A pointer to Database object where execute the selection.
@@ -0,0 +1,248 @@
+#include "connectionpool.h"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <QSqlError>
+#include <QStringList>
+#include <QThread>
+#include <QUrl>
+
+ConnectionPool::ConnectionPool(const QString &databaseFileName, int maxConnections, QObject *parent) : QObject(parent)
+  ,m_databaseFileName(databaseFileName)
+  ,m_maxConnections(maxConnections > 0 ? maxConnections : qMax(2, QThread::idealThreadCount()))
+  ,m_limitedConnections(0)
+  ,m_counter(0)
+  ,m_statementCacheSize(64)
+  ,m_attachmentsVersion(0)
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    QString name;
+    foreach (Connection *connection, m_connections) {
+        name = connection->name;
+        connection->statements.clear();
+        delete connection->query;
+        delete connection;
+        QSqlDatabase::removeDatabase(name);
+    }
+    m_connections.clear();
+}
+
+ConnectionPool::Connection *ConnectionPool::connection()
+{
+    QThread *thread = QThread::currentThread();
+    QMutexLocker locker(&m_mutex);
+
+    // the thread already has a connection, reuse it!
+    Connection *connection = m_connections.value(thread, nullptr);
+    if (connection)
+        return connection;
+
+    // worker threads wait until some connection is released if the pool is full.
+    // The GUI thread never wait, to not freeze the application window, and the dedicated
+    // threads (like the WriteQueue writer) never wait behind the query workers
+    bool isGuiThread = QCoreApplication::instance() && thread == QCoreApplication::instance()->thread();
+    bool isLimited = !isGuiThread && !m_dedicatedThreads.contains(thread);
+    while (isLimited && m_limitedConnections >= m_maxConnections)
+        m_connectionReleased.wait(&m_mutex);
+    if (isLimited)
+        ++m_limitedConnections;
+
+    connection = new Connection;
+    connection->name = QCoreApplication::applicationName() + QStringLiteral("_connection_") + QString::number(++m_counter);
+    connection->statements.setMaxCost(m_statementCacheSize);
+    connection->lastCacheHit = false;
+    connection->inTransaction = false;
+    connection->attachmentsVersion = -1;
+    connection->isLimited = isLimited;
+    m_connections.insert(thread, connection);
+    locker.unlock();
+
+    QSqlDatabase database(QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connection->name));
+    database.setDatabaseName(m_databaseFileName);
+    // the attached databases are opened with a uri, to be read-only
+    database.setConnectOptions(QStringLiteral("QSQLITE_OPEN_URI"));
+    if (database.open())
+        emit logMessage(QStringLiteral("Database connection '") + connection->name + QStringLiteral("' opened!"));
+    else
+        emit logMessage(QStringLiteral("Fatal error on open database connection: ") + database.lastError().text());
+    connection->query = new QSqlQuery(database);
+    connection->lastQuery = connection->query;
+    applyPragmas(connection);
+    applyAttachments(connection);
+
+    // the connection can only be closed by your own thread, so
+    // the release is called directly from the thread when it finishes
+    if (!isGuiThread)
+        connect(thread, &QThread::finished, this, [this, thread]() { release(thread); }, Qt::DirectConnection);
+
+    return connection;
+}
+
+void ConnectionPool::release(QThread *thread)
+{
+    QMutexLocker locker(&m_mutex);
+    Connection *connection = m_connections.take(thread);
+    bool isLimited = connection && connection->isLimited;
+    if (isLimited)
+        --m_limitedConnections;
+    locker.unlock();
+
+    if (!connection)
+        return;
+
+    QString name(connection->name);
+    connection->statements.clear();
+    delete connection->query;
+    delete connection;
+
+    // the QSqlDatabase object needs to be destroyed before removeDatabase
+    {
+        QSqlDatabase database(QSqlDatabase::database(name, false));
+        if (database.isOpen())
+            database.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+    if (isLimited)
+        m_connectionReleased.wakeOne();
+}
+
+void ConnectionPool::applyPragmas(Connection *connection)
+{
+    QMutexLocker locker(&m_mutex);
+    QVariantMap pragmas(m_pragmas);
+    locker.unlock();
+
+    QMap<QString, QVariant>::const_iterator i = pragmas.constBegin();
+    while (i != pragmas.constEnd()) {
+        if (!connection->query->exec(QStringLiteral("PRAGMA ") + i.key() + QStringLiteral(" = ") + i.value().toString()))
+            emit logMessage(QStringLiteral("Error on set PRAGMA ") + i.key() + QStringLiteral(": ") + connection->query->lastError().text());
+        ++i;
+    }
+    connection->query->finish();
+}
+
+void ConnectionPool::updateAttachments(Connection *connection)
+{
+    // sqlite does not attach a database inside a transaction, so the attachment waits the next use
+    QMutexLocker locker(&m_mutex);
+    bool isUpdated = connection->attachmentsVersion == m_attachmentsVersion;
+    locker.unlock();
+    if (!isUpdated && !connection->inTransaction)
+        applyAttachments(connection);
+}
+
+void ConnectionPool::applyAttachments(Connection *connection)
+{
+    QMutexLocker locker(&m_mutex);
+    QMap<QString, QString> attachments(m_attachments);
+    QString mmapSize(m_pragmas.value(QStringLiteral("mmap_size")).toString());
+    int version = m_attachmentsVersion;
+    locker.unlock();
+
+    // uses a separated query, to keep the result set of the connection query
+    QStringList attached;
+    QSqlQuery query(QSqlDatabase::database(connection->name, false));
+    if (query.exec(QStringLiteral("PRAGMA database_list"))) {
+        while (query.next())
+            attached << query.value(1).toString();
+    }
+
+    // the immutable files are read without locks and without check for changes made by other connections
+    QUrl url;
+    QMap<QString, QString>::const_iterator i = attachments.constBegin();
+    for (; i != attachments.constEnd(); ++i) {
+        if (attached.contains(i.key()))
+            continue;
+        url = QUrl::fromLocalFile(i.value());
+        url.setQuery(QStringLiteral("mode=ro&immutable=1"));
+        query.prepare(QStringLiteral("ATTACH DATABASE ? AS ") + i.key());
+        query.bindValue(0, url.toString(QUrl::FullyEncoded));
+        if (!query.exec()) {
+            emit logMessage(QStringLiteral("Error on attach database '") + i.key() + QStringLiteral("': ") + query.lastError().text());
+            continue;
+        }
+        if (!mmapSize.isEmpty())
+            query.exec(QStringLiteral("PRAGMA ") + i.key() + QStringLiteral(".mmap_size = ") + mmapSize);
+        emit logMessage(QStringLiteral("Database '") + i.value() + QStringLiteral("' attached as '") + i.key() + QStringLiteral("' in connection '") + connection->name + QStringLiteral("'"));
+    }
+    query.finish();
+    connection->attachmentsVersion = version;
+}
+
+void ConnectionPool::attachDatabase(const QString &alias, const QString &fileName)
+{
+    QMutexLocker locker(&m_mutex);
+    m_attachments.insert(alias, fileName);
+    ++m_attachmentsVersion;
+}
+
+void ConnectionPool::setPragmas(const QVariantMap &pragmas)
+{
+    static const QStringList supportedPragmas({
+        QStringLiteral("auto_vacuum"),
+        QStringLiteral("busy_timeout"),
+        QStringLiteral("cache_size"),
+        QStringLiteral("journal_mode"),
+        QStringLiteral("mmap_size"),
+        QStringLiteral("synchronous"),
+        QStringLiteral("temp_store")
+    });
+
+    QVariantMap validPragmas;
+    QString value;
+    QMap<QString, QVariant>::const_iterator i = pragmas.constBegin();
+    while (i != pragmas.constEnd()) {
+        value = i.value().toString();
+        // the values are put in query string, so accept only words or numbers
+        if (supportedPragmas.contains(i.key()) && !value.isEmpty() && !value.contains(QRegExp(QStringLiteral("[^\\w-]"))))
+            validPragmas.insert(i.key(), value);
+        else
+            emit logMessage(QStringLiteral("Ignoring invalid database pragma: ") + i.key());
+        ++i;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_pragmas = validPragmas;
+}
+
+void ConnectionPool::setStatementCacheSize(int statementCacheSize)
+{
+    QMutexLocker locker(&m_mutex);
+    m_statementCacheSize = qMax(0, statementCacheSize);
+}
+
+int ConnectionPool::maxConnections() const
+{
+    return m_maxConnections;
+}
+
+void ConnectionPool::setMaxConnections(int maxConnections)
+{
+    if (maxConnections < 1)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_maxConnections = maxConnections;
+    m_connectionReleased.wakeAll();
+}
+
+void ConnectionPool::addDedicatedThread(QThread *thread)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_dedicatedThreads.contains(thread))
+        return;
+    m_dedicatedThreads.insert(thread);
+    connect(thread, &QObject::destroyed, this, [this, thread]() {
+        QMutexLocker locker(&m_mutex);
+        m_dedicatedThreads.remove(thread);
+    }, Qt::DirectConnection);
+}
+
+int ConnectionPool::size()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_connections.size();
+}
@@ -0,0 +1,291 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVariant>
+#include <QWaitCondition>
+
+class QThread;
+
+/**
+ * @brief The ConnectionPool class
+ * Manage a pool of SQLITE connections, one for each thread that access the Database instance.
+ * QSqlDatabase and QSqlQuery objects can only be used from the thread that created them, so each
+ * thread (the GUI thread, AsyncSelect workers or PluginDatabaseTableCreator workers) receive your own named
+ * connection and your own QSqlQuery object. The connection is kept while the thread is running, to be reused
+ * across all calls from the same thread, and is closed and removed when the thread finishes.
+ * The number of connections of the worker threads (the QueryExecutor pool) is limited by 'maxConnections'. When the pool is full,
+ * these threads wait until some connection are released. The GUI thread and the dedicated threads added by addDedicatedThread
+ * (like WriteQueue, the migrations, the imports and the maintenance) never wait and are not counted, so they never stall behind the queries.
+ * After open each connection, the SQLITE pragmas set by setPragmas (auto_vacuum, journal_mode, synchronous, cache_size, mmap_size,
+ * temp_store and busy_timeout) are applied once, before the connection is used by the thread.
+ * The read-only databases added by attachDatabase are attached in each connection under your schema alias:
+ * the new connections on open, and the opened connections when the thread calls updateAttachments (see Database::openConnection).
+ */
+class ConnectionPool : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief The Connection struct
+     * Keeps the connection name, the query objects and the prepared statements cache used by one thread.
+     */
+    struct Connection
+    {
+        /**
+         * @brief name
+         * The unique connection name used by QSqlDatabase::database(name)
+         */
+        QString name;
+
+        /**
+         * @brief query
+         * The QSqlQuery object created with this connection, used to execute the thread generic queries.
+         */
+        QSqlQuery *query;
+
+        /**
+         * @brief lastQuery
+         * A pointer to the last executed query in this connection, used to read the result set,
+         * the last insert id and the last error. Can point to 'query' or to some object in 'statements'.
+         */
+        QSqlQuery *lastQuery;
+
+        /**
+         * @brief statements
+         * A LRU cache with prepared statements, keyed by table name, operation and columns set.
+         * The cache owns the QSqlQuery objects and delete the least recently used when is full.
+         */
+        QCache<QString, QSqlQuery> statements;
+
+        /**
+         * @brief lastCacheHit
+         * True if the last query was reused from 'statements', used by the query profiler.
+         */
+        bool lastCacheHit;
+
+        /**
+         * @brief inTransaction
+         * True between Database::transaction() and Database::commit() or Database::rollback().
+         */
+        bool inTransaction;
+
+        /**
+         * @brief changes
+         * The table changes made in the current transaction, as table name -> list of changes.
+         * The changes are published after the commit and discarded after the rollback.
+         */
+        QHash<QString, QVariantList> changes;
+
+        /**
+         * @brief attachmentsVersion
+         * The version of the pool attachments already attached in this connection
+         */
+        int attachmentsVersion;
+
+        /**
+         * @brief isLimited
+         * True if the connection is counted in the maxConnections limit (not the GUI or a dedicated thread)
+         */
+        bool isLimited;
+    };
+
+    /**
+     * @brief ConnectionPool
+     * @param databaseFileName QString the absolute path to sqlite .db file
+     * @param maxConnections int the max number of connections of the worker threads. If is less than 1, uses max(2, QThread::idealThreadCount()).
+     * @param parent QObject* the object parent
+     */
+    explicit ConnectionPool(const QString &databaseFileName, int maxConnections = 0, QObject *parent = nullptr);
+
+    /**
+     * @brief ~ConnectionPool
+     * The object destructor. Remove all connections still registered in the pool.
+     */
+    virtual ~ConnectionPool();
+
+    /**
+     * @brief connection
+     * Return the connection for the current thread. If the current thread does not have a connection,
+     * a new one will be created and opened. If the pool is full, the caller thread wait for a released connection
+     * (except the GUI thread and the dedicated threads, that always receive a connection).
+     * @return Connection*
+     */
+    Connection *connection();
+
+    /**
+     * @brief maxConnections
+     * Return the max number of connections
+     * @return int
+     */
+    int maxConnections() const;
+
+    /**
+     * @brief setMaxConnections
+     * Set the max number of connections of the worker threads. The value needs to be greater than zero.
+     * @param maxConnections int
+     */
+    void setMaxConnections(int maxConnections);
+
+    /**
+     * @brief size
+     * Return the number of connections currently opened
+     * @return int
+     */
+    int size();
+
+    /**
+     * @brief setPragmas
+     * Set the SQLITE pragmas applied to each new connection, as pragma_name -> value.
+     * Only the supported pragmas are accepted: auto_vacuum, journal_mode, synchronous, cache_size, mmap_size, temp_store and busy_timeout.
+     * The pragmas are applied in new connections only, so needs to be set before the first query.
+     * @param pragmas QVariantMap
+     */
+    void setPragmas(const QVariantMap &pragmas);
+
+    /**
+     * @brief setStatementCacheSize
+     * Set the max number of prepared statements kept by each new connection.
+     * If set to 0 (zero), the prepared statements are not cached.
+     * @param statementCacheSize int
+     */
+    void setStatementCacheSize(int statementCacheSize);
+
+    /**
+     * @brief attachDatabase
+     * Attach the sqlite file 'fileName' as a read-only and immutable schema named 'alias' in all connections,
+     * so the tables can be used as "alias.table_name". The attached file uses the same mmap_size of the main database.
+     * @param alias QString the schema name
+     * @param fileName QString the absolute path of the sqlite file
+     */
+    void attachDatabase(const QString &alias, const QString &fileName);
+
+    /**
+     * @brief updateAttachments
+     * Attach the databases added after the connection was opened. Needs to be called by the connection thread,
+     * before execute a query. Inside a transaction, the attachment is postponed.
+     * @param connection Connection*
+     */
+    void updateAttachments(Connection *connection);
+
+    /**
+     * @brief addDedicatedThread
+     * Exclude 'thread' from the maxConnections limit, so your connection is opened without wait for the worker threads.
+     * Used by the long running threads with a single connection, like WriteQueue. The thread is removed when destroyed.
+     * @param thread QThread*
+     */
+    void addDedicatedThread(QThread *thread);
+
+signals:
+    /**
+     * @brief logMessage
+     * Send operation messages, like errors and opened connections
+     * @param message QString
+     */
+    void logMessage(const QString &message);
+
+private:
+    /**
+     * @brief release
+     * Close and remove the connection used by 'thread'. This method is called from the
+     * thread itself, when QThread::finished is emitted, because the connection can only be closed from your thread.
+     * @param thread QThread* the thread that own the connection
+     */
+    void release(QThread *thread);
+
+    /**
+     * @brief applyPragmas
+     * Execute the m_pragmas in the connection, using the connection query object.
+     * @param connection Connection*
+     */
+    void applyPragmas(Connection *connection);
+
+    /**
+     * @brief applyAttachments
+     * Attach the m_attachments not yet attached in the connection. Called by the connection thread.
+     * @param connection Connection*
+     */
+    void applyAttachments(Connection *connection);
+
+private:
+    /**
+     * @brief m_databaseFileName
+     * The absolute path of the sqlite .db file
+     */
+    QString m_databaseFileName;
+
+    /**
+     * @brief m_maxConnections
+     * The max number of connections of the worker threads
+     */
+    int m_maxConnections;
+
+    /**
+     * @brief m_limitedConnections
+     * The number of opened connections counted in m_maxConnections
+     */
+    int m_limitedConnections;
+
+    /**
+     * @brief m_dedicatedThreads
+     * The threads excluded from the m_maxConnections limit
+     */
+    QSet<QThread*> m_dedicatedThreads;
+
+    /**
+     * @brief m_counter
+     * Incremented for each created connection and used to build unique connections names
+     */
+    quint64 m_counter;
+
+    /**
+     * @brief m_mutex
+     * Protect m_connections from concurrent access
+     */
+    QMutex m_mutex;
+
+    /**
+     * @brief m_connectionReleased
+     * Wake up the threads waiting for a connection when some connection is released
+     */
+    QWaitCondition m_connectionReleased;
+
+    /**
+     * @brief m_connections
+     * Keeps the connection for each thread
+     */
+    QHash<QThread*, Connection*> m_connections;
+
+    /**
+     * @brief m_pragmas
+     * The SQLITE pragmas applied in each new connection, as pragma_name -> value.
+     * The busy_timeout is ordered first by QMap, so it is applied before the journal_mode change.
+     */
+    QVariantMap m_pragmas;
+
+    /**
+     * @brief m_statementCacheSize
+     * The max number of prepared statements kept in the cache of each connection
+     */
+    int m_statementCacheSize;
+
+    /**
+     * @brief m_attachments
+     * The read-only databases attached in each connection, as schema alias -> file path
+     */
+    QMap<QString, QString> m_attachments;
+
+    /**
+     * @brief m_attachmentsVersion
+     * Incremented by each attachDatabase, so the opened connections know when needs to attach the new databases
+     */
+    int m_attachmentsVersion;
+};
+
+#endif // CONNECTIONPOOL_H
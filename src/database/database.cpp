@@ -1,15 +1,36 @@
 #include "database.h"
+#include "connectionpool.h"
+#include "jsonimporter.h"
+#include "queryexecutor.h"
+#include "queryprofiler.h"
+#include "resultcache.h"
+#include "../core/utils.h"
 
 #include <QApplication>
 #include <QByteArray>
+#include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegExp>
+#include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlRecord>
 #include <QStandardPaths>
 #include <QStringList>
 #include <QUrl>
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#include <QCborValue>
+#endif
+
 #ifdef QT_DEBUG
 #include <QDebug>
 #endif
@@ -17,8 +38,14 @@
 Database* Database::m_instance = nullptr;
 
 Database::Database(QObject *parent) : QObject(parent)
+  ,m_schemaReady(1)
 {
     setFileName();
+    m_connectionPool = new ConnectionPool(m_databaseFileName, 0, this);
+    m_resultCache = new ResultCache;
+    connect(m_connectionPool, &ConnectionPool::logMessage, this, &Database::logMessage);
+    connect(QueryProfiler::instance(), &QueryProfiler::logMessage, this, &Database::logMessage);
+    loadSettings();
 #ifdef QT_DEBUG
     connect(this, &Database::logMessage, [this](const QString &message) {
         qDebug() << message;
@@ -28,8 +55,8 @@ Database::Database(QObject *parent) : QObject(parent)
 
 Database::~Database()
 {
-    if (m_qSqlDatabase.isOpen())
-        m_qSqlDatabase.close();
+    delete m_connectionPool;
+    delete m_resultCache;
 }
 
 Database *Database::instance()
@@ -46,7 +73,12 @@ QStringList Database::tableColumns(const QString &tableName)
     QStringList list;
     if (tableName.isEmpty())
         return list;
-    queryExec(QStringLiteral("PRAGMA table_info(") + tableName + QStringLiteral(");"));
+    // the tables of the attached databases are qualified by the schema, like "catalog.products"
+    int dot = tableName.indexOf(QLatin1Char('.'));
+    if (dot > 0)
+        queryExec(QStringLiteral("PRAGMA ") + tableName.left(dot) + QStringLiteral(".table_info(") + tableName.mid(dot + 1) + QStringLiteral(");"));
+    else
+        queryExec(QStringLiteral("PRAGMA table_info(") + tableName + QStringLiteral(");"));
     QVariantList result(resultSet());
     foreach (const QVariant &item, result)
         list << item.toMap().value(QStringLiteral("name")).toString();
@@ -64,18 +96,19 @@ QVariantList Database::resultSet(enum SELECT_TYPE selectType)
     QSqlRecord record;
     QVariantMap map;
     QVariantList resultSet;
+    QSqlQuery *sqlQuery = query();
 
-    while (m_qsqlQuery.next()) {
-        record = m_qsqlQuery.record();
-        if (record.isEmpty() || !m_qsqlQuery.isValid())
+    while (sqlQuery->next()) {
+        record = sqlQuery->record();
+        if (record.isEmpty() || !sqlQuery->isValid())
             continue;
         totalColumns = record.count();
 
         for (i = 0; i < totalColumns; ++i) {
             if (selectType == All_Itens_Int)
-                map.insert(record.fieldName(i), m_qsqlQuery.value(i));
+                map.insert(record.fieldName(i), decodeValue(sqlQuery->value(i)));
             else if (selectType == Meta_Key_Value_Int)
-                map.insert(m_qsqlQuery.value(0).toString(), m_qsqlQuery.value(1));
+                map.insert(sqlQuery->value(0).toString(), sqlQuery->value(1));
         }
 
         if (!map.isEmpty())
@@ -84,64 +117,396 @@ QVariantList Database::resultSet(enum SELECT_TYPE selectType)
     return resultSet;
 }
 
-void Database::openConnection()
+bool Database::openConnection()
+{
+    // get (or create) the connection for the current thread.
+    // QSqlDatabase::database opens the connection if is not yet opened.
+    ConnectionPool::Connection *connection = m_connectionPool->connection();
+    QSqlDatabase database(QSqlDatabase::database(connection->name));
+    if (database.isOpen()) {
+        m_connectionPool->updateAttachments(connection);
+        return true;
+    }
+    emit logMessage(QStringLiteral("Fatal error on init database! Connection cannot be opened!"));
+    return false;
+}
+
+QSqlQuery *Database::query() const
+{
+    return m_connectionPool->connection()->lastQuery;
+}
+
+QSqlQuery *Database::defaultQuery()
+{
+    ConnectionPool::Connection *connection = m_connectionPool->connection();
+    connection->lastQuery = connection->query;
+    connection->lastCacheHit = false;
+    return connection->query;
+}
+
+QSqlQuery *Database::cachedStatement(const QString &cacheKey)
+{
+    ConnectionPool::Connection *connection = m_connectionPool->connection();
+    QSqlQuery *sqlQuery = connection->statements.object(cacheKey);
+    if (!sqlQuery) {
+        m_statementCacheMisses.ref();
+        return nullptr;
+    }
+    m_statementCacheHits.ref();
+    connection->lastQuery = sqlQuery;
+    connection->lastCacheHit = true;
+    return sqlQuery;
+}
+
+QSqlQuery *Database::prepareStatement(const QString &cacheKey, const QString &sqlQueryString)
 {
-    QString applicationName(QApplication::applicationName());
-    if (!m_qSqlDatabase.isOpen()) {
-        if (!QSqlDatabase::contains(applicationName)) {
-            m_qSqlDatabase = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), applicationName);
-            m_qSqlDatabase.setDatabaseName(m_databaseFileName);
+    ConnectionPool::Connection *connection = m_connectionPool->connection();
+    if (connection->statements.maxCost() > 0) {
+        QSqlQuery *sqlQuery = new QSqlQuery(QSqlDatabase::database(connection->name));
+        if (sqlQuery->prepare(sqlQueryString)) {
+            // the cache takes the ownership and can delete the least recently used statement
+            connection->statements.insert(cacheKey, sqlQuery);
+            connection->lastQuery = sqlQuery;
+            connection->lastCacheHit = false;
+            return sqlQuery;
         }
-        m_qSqlDatabase = QSqlDatabase::database(applicationName);
-        m_qsqlQuery = QSqlQuery(m_qSqlDatabase);
+        delete sqlQuery;
     }
-    if (!m_qSqlDatabase.isOpen())
-        emit logMessage(QStringLiteral("Fatal error on init database! Connection cannot be opened!"));
+    // prepare in the default query, to keep the error message to lastError()
+    QSqlQuery *sqlQuery = defaultQuery();
+    sqlQuery->prepare(sqlQueryString);
+    return sqlQuery;
 }
 
 void Database::createTable(const QString &filePath)
+{
+    QStringList statements;
+    if (!readSqlFile(filePath, &statements))
+        return;
+
+    // all statements of the file are executed in a single transaction
+    if (queryExec(QStringLiteral("BEGIN IMMEDIATE TRANSACTION")) && execStatements(statements) && queryExec(QStringLiteral("COMMIT"))) {
+        QFile::setPermissions(m_databaseFileName, QFile::WriteOwner | QFile::ReadGroup | QFile::ReadUser | QFile::ReadOther);
+        emit logMessage(QStringLiteral("Database table for '") + filePath + QStringLiteral("' created!"));
+    } else {
+        emit logMessage(QStringLiteral("Fatal error on try to create table from '") + filePath + QStringLiteral("': ") + lastError());
+        queryExec(QStringLiteral("ROLLBACK"));
+    }
+}
+
+int Database::schemaVersion(const QString &pluginName)
+{
+    openConnection();
+
+    QString cacheKey(QStringLiteral("schema_version"));
+    QSqlQuery *sqlQuery = cachedStatement(cacheKey);
+    if (!sqlQuery)
+        sqlQuery = prepareStatement(cacheKey, QStringLiteral("SELECT version FROM schema_migrations WHERE plugin = ?"));
+
+    // if the metadata table does not exists, no migration was applied yet
+    sqlQuery->bindValue(0, pluginName);
+    if (!sqlQuery->exec())
+        return 0;
+    int version = sqlQuery->next() ? sqlQuery->value(0).toInt() : 0;
+    sqlQuery->finish();
+    return version;
+}
+
+bool Database::isSchemaReady() const
+{
+    return m_schemaReady.load() == 1;
+}
+
+void Database::setSchemaReady(bool schemaReady)
+{
+    m_schemaReady.store(schemaReady ? 1 : 0);
+    if (schemaReady)
+        emit schemaReady();
+}
+
+QMap<int, QString> Database::migrationFiles(const QString &pluginDirPath)
+{
+    QMap<int, QString> files;
+
+    // the first version is the plugin table file
+    if (QFile::exists(pluginDirPath + QStringLiteral("/plugin_table.sql")))
+        files.insert(1, pluginDirPath + QStringLiteral("/plugin_table.sql"));
+
+    // the next versions are in 'migrations' directory, with the version number as file name prefix, like: "2_add_user_column.sql"
+    bool isNumber = false;
+    int version = 0;
+    QDir dir(pluginDirPath + QStringLiteral("/migrations"));
+    foreach (const QString &fileName, dir.entryList({QStringLiteral("*.sql")}, QDir::Files)) {
+        version = fileName.section(QRegExp(QStringLiteral("[^0-9]")), 0, 0).toInt(&isNumber);
+        if (isNumber && version > 0)
+            files.insert(version, dir.absoluteFilePath(fileName));
+        else
+            emit logMessage(QStringLiteral("Ignoring migration file without version number: ") + dir.absoluteFilePath(fileName));
+    }
+    return files;
+}
+
+bool Database::migrate(const QString &pluginName, const QString &pluginDirPath)
+{
+    if (pluginName.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try migrate: The plugin name is empty!"));
+        return false;
+    }
+
+    // the directory is listed, but only the pending files are read and parsed
+    QMap<int, QString> files(migrationFiles(pluginDirPath));
+    if (files.isEmpty())
+        return true;
+
+    int currentVersion = schemaVersion(pluginName);
+    if (currentVersion >= files.lastKey())
+        return true;
+
+    QStringList statements;
+
+    QMap<int, QString>::const_iterator i = files.upperBound(currentVersion);
+    for (; i != files.constEnd(); ++i) {
+        statements.clear();
+        if (!readSqlFile(i.value(), &statements))
+            return false;
+
+        // the installs created before the migrations already have the plugin_table.sql tables (created ignoring the errors),
+        // so the file is not executed again and the version 1 is saved as the baseline
+        bool isBaseline = i.key() == 1 && currentVersion == 0 && hasCreatedTables(statements);
+
+        // each migration and your version number are saved in a single transaction.
+        // The IMMEDIATE transaction get the write lock before read the schema
+        if (!queryExec(QStringLiteral("BEGIN IMMEDIATE TRANSACTION"))) {
+            emit logMessage(QStringLiteral("Fatal error on try begin migration transaction: ") + lastError());
+            return false;
+        }
+        if (!queryExec(QStringLiteral("CREATE TABLE IF NOT EXISTS schema_migrations (plugin TEXT PRIMARY KEY NOT NULL, version INTEGER NOT NULL, applied_at INTEGER)"))
+                || (!isBaseline && !execStatements(statements))
+                || !saveSchemaVersion(pluginName, i.key())
+                || !queryExec(QStringLiteral("COMMIT"))) {
+            emit logMessage(QString(QStringLiteral("Fatal error on migrate '%1' to version %2: %3")).arg(pluginName).arg(i.key()).arg(lastError()));
+            queryExec(QStringLiteral("ROLLBACK"));
+            return false;
+        }
+        if (isBaseline)
+            emit logMessage(QString(QStringLiteral("Plugin '%1' tables already exists, version 1 saved as baseline")).arg(pluginName));
+        else
+            emit logMessage(QString(QStringLiteral("Plugin '%1' database migrated to version %2")).arg(pluginName).arg(i.key()));
+    }
+
+    QFile::setPermissions(m_databaseFileName, QFile::WriteOwner | QFile::ReadGroup | QFile::ReadUser | QFile::ReadOther);
+    return true;
+}
+
+bool Database::hasCreatedTables(const QStringList &statements)
+{
+    QRegExp createTable(QStringLiteral("^CREATE\\s+TABLE\\s+(?:IF\\s+NOT\\s+EXISTS\\s+)?[\"`\\[]?([A-Za-z_][A-Za-z0-9_]*).*"), Qt::CaseInsensitive);
+    QStringList tables;
+    foreach (const QString &statement, statements) {
+        if (createTable.exactMatch(statement.simplified()))
+            tables << createTable.cap(1);
+    }
+    if (tables.isEmpty())
+        return false;
+
+    QSqlQuery *sqlQuery = defaultQuery();
+    sqlQuery->prepare(QStringLiteral("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = ?"));
+    foreach (const QString &table, tables) {
+        sqlQuery->bindValue(0, table);
+        if (!sqlQuery->exec() || !sqlQuery->next() || sqlQuery->value(0).toInt() == 0) {
+            sqlQuery->finish();
+            return false;
+        }
+    }
+    sqlQuery->finish();
+    return true;
+}
+
+bool Database::saveSchemaVersion(const QString &pluginName, int version)
+{
+    QSqlQuery *sqlQuery = defaultQuery();
+    sqlQuery->prepare(QStringLiteral("INSERT OR REPLACE INTO schema_migrations (plugin, version, applied_at) VALUES (?, ?, ?)"));
+    sqlQuery->bindValue(0, pluginName);
+    sqlQuery->bindValue(1, version);
+    sqlQuery->bindValue(2, QDateTime::currentDateTime().toSecsSinceEpoch());
+    return sqlQuery->exec();
+}
+
+bool Database::readSqlFile(const QString &filePath, QStringList *statements)
 {
     QFile file(filePath);
     if (!file.exists()) {
         emit logMessage(QStringLiteral("Fatal error on build database. The file '") + file.fileName() + QStringLiteral("' cannot be not found!"));
-        return;
+        return false;
     } else if (!file.open(QIODevice::ReadOnly)) {
         emit logMessage(QStringLiteral("Fatal error on try to create table! The file '") + file.fileName() + QStringLiteral("' cannot be opened!"));
-        return;
+        return false;
     }
 
-    bool hasText;
-    QByteArray readLine;
-    QString line;
-    QString cleanedLine;
-    QStringList strings;
-
-    while (!file.atEnd()) {
-        hasText     = false;
-        line        = "";
-        readLine    = "";
-        cleanedLine = "";
-        strings.clear();
-        while (!hasText) {
-            readLine    = file.readLine();
-            cleanedLine = readLine.trimmed();
-            strings     = cleanedLine.split("--");
-            cleanedLine = strings.at(0);
-            if (!cleanedLine.startsWith("--") && !cleanedLine.isEmpty())
-                line += cleanedLine;
-            if (cleanedLine.endsWith(";"))
-                break;
-            if (cleanedLine.startsWith("COMMIT"))
-                hasText = true;
-        }
-        if (!line.isEmpty())
-            queryExec(line);
-        if (!m_qsqlQuery.isActive())
-            emit logMessage(m_qsqlQuery.lastError().text());
+    QRegExp transactionStatement(QStringLiteral("^(BEGIN|COMMIT|END|ROLLBACK)\\b.*"), Qt::CaseInsensitive);
+    foreach (const QString &statement, splitStatements(QString::fromUtf8(file.readAll()))) {
+        // the transaction is managed by the caller, so the transaction statements of the file are ignored
+        if (!transactionStatement.exactMatch(statement))
+            statements->append(statement);
     }
     file.close();
-    QFile::setPermissions(m_databaseFileName, QFile::WriteOwner | QFile::ReadGroup | QFile::ReadUser | QFile::ReadOther);
-    emit logMessage(QStringLiteral("Database table for '") + filePath + QStringLiteral("' created!"));
+    return true;
+}
+
+bool Database::execStatements(const QStringList &statements)
+{
+    foreach (const QString &statement, statements) {
+        if (!queryExec(statement))
+            return false;
+    }
+    return true;
+}
+
+QStringList Database::splitStatements(const QString &sql)
+{
+    // a port of the sqlite3_complete() state machine (see sqlite/src/complete.c), used to find where each
+    // statement ends: the semicolons inside strings, quoted identifiers, comments and 'CREATE TRIGGER ... END;'
+    // bodies does not finish the statement.
+    enum Token { Semi = 0, Ws, Other, Explain, Create, Temp, Trigger, End };
+    static const int transitions[8][8] = {
+        /* 0 INVALID: */ { 1, 0, 2, 3, 4, 2, 2, 2 },
+        /* 1 START:   */ { 1, 1, 2, 3, 4, 2, 2, 2 },
+        /* 2 NORMAL:  */ { 1, 2, 2, 2, 2, 2, 2, 2 },
+        /* 3 EXPLAIN: */ { 1, 3, 3, 2, 4, 2, 2, 2 },
+        /* 4 CREATE:  */ { 1, 4, 2, 2, 2, 4, 5, 2 },
+        /* 5 TRIGGER: */ { 6, 5, 5, 5, 5, 5, 5, 5 },
+        /* 6 SEMI:    */ { 6, 6, 5, 5, 5, 5, 5, 7 },
+        /* 7 END:     */ { 1, 7, 5, 5, 5, 5, 5, 5 }
+    };
+
+    QStringList statements;
+    QString word;
+    QChar c;
+    QChar close;
+    Token token;
+    int state = 0;
+    int previousState = 0;
+    int start = 0;
+    int i = 0;
+    int j = 0;
+    int size = sql.size();
+
+    while (i < size) {
+        c = sql.at(i);
+        if (c == QLatin1Char(';')) {
+            token = Semi;
+            ++i;
+        } else if (c.isSpace()) {
+            token = Ws;
+            ++i;
+        } else if (c == QLatin1Char('-') && i + 1 < size && sql.at(i + 1) == QLatin1Char('-')) {
+            // a line comment
+            j = sql.indexOf(QLatin1Char('\n'), i);
+            i = j < 0 ? size : j + 1;
+            token = Ws;
+        } else if (c == QLatin1Char('/') && i + 1 < size && sql.at(i + 1) == QLatin1Char('*')) {
+            // a block comment
+            j = sql.indexOf(QStringLiteral("*/"), i + 2);
+            i = j < 0 ? size : j + 2;
+            token = Ws;
+        } else if (c == QLatin1Char('\'') || c == QLatin1Char('"') || c == QLatin1Char('`') || c == QLatin1Char('[')) {
+            // a string or a quoted identifier
+            close = c == QLatin1Char('[') ? QLatin1Char(']') : c;
+            j = sql.indexOf(close, i + 1);
+            i = j < 0 ? size : j + 1;
+            token = Other;
+        } else if (c.isLetter() || c == QLatin1Char('_')) {
+            j = i;
+            while (j < size && (sql.at(j).isLetterOrNumber() || sql.at(j) == QLatin1Char('_') || sql.at(j) == QLatin1Char('$')))
+                ++j;
+            word = sql.mid(i, j - i).toLower();
+            i = j;
+            if (word == QLatin1String("create"))
+                token = Create;
+            else if (word == QLatin1String("trigger"))
+                token = Trigger;
+            else if (word == QLatin1String("temp") || word == QLatin1String("temporary"))
+                token = Temp;
+            else if (word == QLatin1String("end"))
+                token = End;
+            else if (word == QLatin1String("explain"))
+                token = Explain;
+            else
+                token = Other;
+        } else {
+            token = Other;
+            ++i;
+        }
+
+        previousState = state;
+        state = transitions[state][token];
+        // the statement is complete. Empty statements (only comments or semicolons) are ignored
+        if (token == Semi && state == 1) {
+            if (previousState > 1)
+                statements << sql.mid(start, i - start).trimmed();
+            start = i;
+        } else if (token == Ws && state <= 1) {
+            // skip the comments before the statement
+            start = i;
+        }
+    }
+
+    // the last statement without semicolon
+    if (state > 1)
+        statements << sql.mid(start).trimmed();
+    return statements;
+}
+
+void Database::loadSettings()
+{
+    // the default pragmas uses WAL journal, so readers (like AsyncSelect workers)
+    // never block the writers and the writers does not fsync on each commit
+    QVariantMap pragmas;
+    pragmas.insert(QStringLiteral("journal_mode"), QStringLiteral("WAL"));
+    pragmas.insert(QStringLiteral("synchronous"), QStringLiteral("NORMAL"));
+    pragmas.insert(QStringLiteral("cache_size"), -8000);
+    pragmas.insert(QStringLiteral("mmap_size"), 33554432);
+    pragmas.insert(QStringLiteral("temp_store"), QStringLiteral("MEMORY"));
+    pragmas.insert(QStringLiteral("busy_timeout"), 5000);
+    // the pragmas are applied in the name order, so auto_vacuum is set before the WAL journal
+    pragmas.insert(QStringLiteral("auto_vacuum"), QStringLiteral("INCREMENTAL"));
+
+    // override the default values with the "database" object from config.json
+    QVariantMap config(Utils::instance()->readFile(QStringLiteral(":/config.json")).toMap().value(QStringLiteral("database")).toMap());
+    // each QueryExecutor worker can keep a connection, the other threads are not limited
+    if (config.contains(QStringLiteral("max_connections")))
+        m_connectionPool->setMaxConnections(config.take(QStringLiteral("max_connections")).toInt());
+    else
+        m_connectionPool->setMaxConnections(QueryExecutor::instance()->maxThreadCount());
+    if (config.contains(QStringLiteral("statement_cache_size")))
+        m_connectionPool->setStatementCacheSize(config.take(QStringLiteral("statement_cache_size")).toInt());
+    if (config.contains(QStringLiteral("result_cache_size")))
+        m_resultCache->setMaxSize(config.take(QStringLiteral("result_cache_size")).toInt());
+
+    // the options read by QueryExecutor, WriteQueue, QueryProfiler and DatabaseMaintenance are not pragmas
+    static const QStringList otherOptions({
+        QStringLiteral("maintenance_background_budget_ms"),
+        QStringLiteral("maintenance_budget_ms"),
+        QStringLiteral("maintenance_idle_ms"),
+        QStringLiteral("maintenance_interval_ms"),
+        QStringLiteral("maintenance_vacuum_pages"),
+        QStringLiteral("maintenance_vacuum_ratio"),
+        QStringLiteral("profile_dump_file"),
+        QStringLiteral("profile_queries"),
+        QStringLiteral("query_threads"),
+        QStringLiteral("slow_query_ms"),
+        QStringLiteral("write_batch_rows"),
+        QStringLiteral("write_flush_interval")
+    });
+    foreach (const QString &option, otherOptions)
+        config.remove(option);
+
+    QMap<QString, QVariant>::const_iterator i = config.constBegin();
+    while (i != config.constEnd()) {
+        pragmas.insert(i.key(), i.value());
+        ++i;
+    }
+    m_connectionPool->setPragmas(pragmas);
 }
 
 void Database::setFileName()
@@ -162,16 +527,66 @@ void Database::setFileName()
     emit logMessage(QStringLiteral("Database absolute name defined to: ") + m_databaseFileName);
 }
 
+bool Database::attachSeedDatabase(const QString &alias, const QString &filePath)
+{
+    static const QStringList reservedNames({QStringLiteral("main"), QStringLiteral("temp")});
+    QRegExp identifier(QStringLiteral("[A-Za-z_][A-Za-z0-9_]*"));
+    if (!identifier.exactMatch(alias) || reservedNames.contains(alias.toLower())) {
+        emit logMessage(QStringLiteral("Fatal error on try attach seed database: invalid schema alias '") + alias + QStringLiteral("'"));
+        return false;
+    }
+
+    QFileInfo source(filePath);
+    if (!source.exists()) {
+        emit logMessage(QStringLiteral("Fatal error on try attach seed database: the file '") + filePath + QStringLiteral("' does not exists!"));
+        return false;
+    }
+
+    // sqlite reads only files from the file system, so the files from android assets or
+    // qt resources are copied once to the application directory (and again when the file changes)
+    QString fileName(source.absoluteFilePath());
+    if (filePath.startsWith(QStringLiteral("assets:")) || filePath.startsWith(QStringLiteral(":"))) {
+        QDir dir(QFileInfo(m_databaseFileName).absolutePath() + QStringLiteral("/seeds"));
+        if (!dir.exists())
+            dir.mkpath(dir.absolutePath());
+        fileName = dir.absoluteFilePath(alias + QStringLiteral(".db"));
+        QFileInfo target(fileName);
+        if (!target.exists() || target.size() != source.size() || (source.lastModified().isValid() && source.lastModified() > target.lastModified())) {
+            QFile::remove(fileName);
+            if (!QFile::copy(filePath, fileName)) {
+                emit logMessage(QStringLiteral("Fatal error on try copy the seed database '") + filePath + QStringLiteral("'"));
+                return false;
+            }
+        }
+    }
+
+    m_connectionPool->attachDatabase(alias, fileName);
+    return true;
+}
+
+QString Database::fileName() const
+{
+    return m_databaseFileName;
+}
+
+void Database::addDedicatedThread(QThread *thread)
+{
+    m_connectionPool->addDedicatedThread(thread);
+}
+
 bool Database::queryExec(const QString &query)
 {
     openConnection();
 
-    if (m_qsqlQuery.exec(query)) {
+    QSqlQuery *sqlQuery = defaultQuery();
+    if (execStatement(sqlQuery, query)) {
+        // the query can write in some table with cached result sets
+        m_resultCache->invalidateQuery(query);
         emit logMessage(QStringLiteral("Query success executed: ") + query);
         return true;
     }
 
-    if (m_qsqlQuery.lastError().type() != QSqlError::NoError)
+    if (sqlQuery->lastError().type() != QSqlError::NoError)
         emit logMessage(QStringLiteral("Fatal error on try execute query: ") + lastError());
 
     return false;
@@ -180,182 +595,1622 @@ bool Database::queryExec(const QString &query)
 QVariantList Database::select(const QString &tableName, const QVariantMap &where, const QVariantMap &args)
 {
     QVariantList resultSet;
+    SELECT_TYPE selectType = static_cast<SELECT_TYPE>(args.value(QStringLiteral("selectType"), SELECT_TYPE::All_Itens_Int).toInt());
+
+    // the same selection is returned from the result cache until the table is changed
+    ResultCache::Entry entry;
+    QString cacheKey(resultCacheKey(tableName, where, args, QString::number(selectType)));
+    if (!cacheKey.isEmpty() && m_resultCache->find(cacheKey, &entry))
+        return entry.items;
+    int generation = m_resultCache->generation(tableName);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlQuery *sqlQuery = selectCursor(tableName, where, args);
+    if (!sqlQuery)
+        return resultSet;
+
+    int totalColumns = sqlQuery->record().count();
+    if (!totalColumns || !sqlQuery->size())
+        return resultSet;
+
+    resultSet = this->resultSet(selectType);
+    // the select time includes the time to read all rows
+    profileQuery(sqlQuery, timer.nsecsElapsed(), resultSet.size());
+
+    // reset the statement to release the read lock, keeping it prepared to the next call
+    sqlQuery->finish();
+
+    if (!cacheKey.isEmpty()) {
+        entry.items = resultSet;
+        m_resultCache->insert(tableName, cacheKey, entry, generation);
+    }
+    return resultSet;
+}
+
+QString Database::resultCacheKey(const QString &tableName, const QVariantMap &where, const QVariantMap &args, const QString &resultFormat)
+{
+    // the full text search is not cached, because the search text changes on each key
+    if (tableName.isEmpty() || args.contains(QStringLiteral("search")) || !m_resultCache->isEnabled())
+        return QString();
+
+    // the key is the table, the format of the rows, the query and the bound values
+    QVariantList values;
+    QString query(selectQueryString(tableName, where, args, &values));
+    QByteArray boundValues(QJsonDocument(QJsonArray::fromVariantList(values)).toJson(QJsonDocument::Compact));
+    return tableName + QLatin1Char('\n') + resultFormat + QLatin1Char('\n') + query + QLatin1Char('\n') + QString::fromUtf8(boundValues);
+}
+
+ResultCache *Database::resultCache() const
+{
+    return m_resultCache;
+}
+
+QVariantMap Database::resultCacheStats() const
+{
+    return m_resultCache->stats();
+}
+
+QSqlQuery *Database::selectCursor(const QString &tableName, const QVariantMap &where, const QVariantMap &args)
+{
     if (tableName.isEmpty()) {
         emit logMessage(QStringLiteral("Fatal error on try select data: The table name is empty!"));
-        return resultSet;
+        return nullptr;
     }
 
-    openConnection();
-    if (!m_qSqlDatabase.isOpen()) {
+    if (!openConnection()) {
         emit logMessage(QStringLiteral("Fatal error on try select: Database connection cannot be opened!"));
-        return resultSet;
+        return nullptr;
     }
 
+    QVariantList values;
+    QString query(selectQueryString(tableName, where, args, &values));
+    if (query.isEmpty())
+        return nullptr;
+
+    // the generated query is the statement cache key
+    QSqlQuery *sqlQuery = cachedStatement(query);
+    if (!sqlQuery)
+        sqlQuery = prepareStatement(query, query);
+
+    int k = 0;
+    foreach (const QVariant &value, values)
+        sqlQuery->bindValue(k++, value);
+
+    // the caller profile the query after read the rows
+    if (!execStatement(sqlQuery, QString(), false))
+        return nullptr;
+
+    emit logMessage(QStringLiteral("Query success executed: ") + query);
+    return sqlQuery;
+}
+
+QString Database::selectQueryString(const QString &tableName, const QVariantMap &where, const QVariantMap &args, QVariantList *bindValues)
+{
     int limit = args.value(QStringLiteral("limit"), -1).toInt();
     int offset = args.value(QStringLiteral("offset"), 0).toInt();
-    QString order = args.value(QStringLiteral("order"), QStringLiteral("asc")).toString();
+    QString order = args.value(QStringLiteral("order"), QStringLiteral("asc")).toString().toLower();
     QString orderBy = args.value(QStringLiteral("orderby"), QStringLiteral("")).toString();
     QString whereOperator = args.value(QStringLiteral("whereOperator"), QStringLiteral("AND")).toString();
     QString whereComparator = args.value(QStringLiteral("whereOperator"), QStringLiteral("=")).toString();
-    SELECT_TYPE selectType = static_cast<SELECT_TYPE>(args.value(QStringLiteral("selectType"), SELECT_TYPE::All_Itens_Int).toInt());
     bool withLikeClause = (whereComparator.compare(QStringLiteral("LIKE"), Qt::CaseInsensitive) == 0);
+    bool hasAfter = args.contains(QStringLiteral("after"));
+    bool hasBefore = !hasAfter && args.contains(QStringLiteral("before"));
+    // the keyset column is put in the query string, so a invalid name is not selected
+    QString pkColumn((hasAfter || hasBefore) ? this->pkColumn(args) : QString());
+    if ((hasAfter || hasBefore) && pkColumn.isEmpty())
+        return QString();
+    // the order is put in the query string too
+    if (order != QStringLiteral("asc") && order != QStringLiteral("desc")) {
+        emit logMessage(QStringLiteral("Ignoring invalid order in select: ") + order);
+        order = QStringLiteral("asc");
+    }
+
+    // the selected columns and aggregates. The names are put in query string, so accept only identifiers
+    QStringList selectList;
+    QStringList groupBy(identifiers(args.value(QStringLiteral("groupBy"))));
+    QStringList columns(identifiers(args.value(QStringLiteral("columns"))));
+    // the keyset pagination needs the primary key to create the page tokens
+    if ((hasAfter || hasBefore) && !columns.isEmpty() && !columns.contains(pkColumn))
+        columns.prepend(pkColumn);
+    QString expression;
+    foreach (const QString &column, groupBy.isEmpty() ? columns : groupBy + columns) {
+        // a json path, like "profile.city", is selected as "profile_city"
+        expression = columnExpression(tableName, column);
+        if (expression != column)
+            expression += QStringLiteral(" as ") + QString(column).replace(QLatin1Char('.'), QLatin1Char('_'));
+        if (!expression.isEmpty() && !selectList.contains(expression))
+            selectList << expression;
+    }
+    static const QStringList aggregates({QStringLiteral("count"), QStringLiteral("sum"), QStringLiteral("avg"), QStringLiteral("min"), QStringLiteral("max")});
+    foreach (const QString &aggregate, aggregates) {
+        // "count": "*" is selected as "count", and "sum": "price" is selected as "sum_price"
+        foreach (const QString &column, identifiers(args.value(aggregate), aggregate == QStringLiteral("count"))) {
+            if (column == QStringLiteral("*"))
+                selectList << aggregate + QStringLiteral("(*) as ") + aggregate;
+            else if (!(expression = columnExpression(tableName, column)).isEmpty())
+                selectList << aggregate + QStringLiteral("(") + expression + QStringLiteral(") as ") + aggregate + QStringLiteral("_") + QString(column).replace(QLatin1Char('.'), QLatin1Char('_'));
+        }
+    }
 
     QString whereStr;
-    QString query(QStringLiteral("select * from ") + tableName);
+    QString query(QStringLiteral("select ") + (selectList.isEmpty() ? QStringLiteral("*") : selectList.join(QStringLiteral(", "))) + QStringLiteral(" from ") + tableName);
 
     if (!where.isEmpty()) {
         int k = 0;
-        foreach (const QString &key, where.keys())
-            whereStr.append(QString(QStringLiteral("%1 %2 %3 %4")).arg(k++ == 0 ? "" : " " + whereOperator, key, whereComparator, "?"));
-        query.append(QStringLiteral(" where ")).append(whereStr.remove("  ").trimmed().simplified());
+        foreach (const QString &key, where.keys()) {
+            // the json paths are compared with json_extract, using the json indexes if exists (see createJsonIndex)
+            expression = columnExpression(tableName, key);
+            if (expression.isEmpty())
+                continue;
+            whereStr.append(QString(QStringLiteral("%1 %2 %3 %4")).arg(k++ == 0 ? "" : " " + whereOperator, expression, whereComparator, "?"));
+            bindValues->append(withLikeClause ? QVariant("\%"+where.value(key).toString()+"\%") : where.value(key));
+        }
+        whereStr = whereStr.remove("  ").trimmed().simplified();
+    }
+
+    // keyset pagination: instead of skip 'offset' rows, filter the rows after (or before)
+    // the primary key saved in the token and order by the primary key.
+    // The cost of each page is the same at row 100 or at row 1.000.000.
+    if (hasAfter || hasBefore) {
+        bool isDescending = order.compare(QStringLiteral("desc"), Qt::CaseInsensitive) == 0;
+        // 'after' continue in the order direction, 'before' go back in the opposite direction
+        bool isReverse = hasBefore != isDescending;
+        QVariant pkValue(decodePageToken(args.value(hasAfter ? QStringLiteral("after") : QStringLiteral("before")).toString()));
+        if (pkValue.isValid()) {
+            if (!whereStr.isEmpty())
+                whereStr = QStringLiteral("(") + whereStr + QStringLiteral(") and ");
+            whereStr += pkColumn + (isReverse ? QStringLiteral(" < ?") : QStringLiteral(" > ?"));
+            bindValues->append(pkValue);
+        }
+        if (!whereStr.isEmpty())
+            query.append(QStringLiteral(" where ")).append(whereStr);
+        query.append(QStringLiteral(" order by ") + pkColumn + (isReverse ? QStringLiteral(" desc") : QStringLiteral(" asc")));
+        if (limit > 0)
+            query.append(QStringLiteral(" limit ") + QString::number(limit));
+        // the 'before' page is selected in reverse order, so restore the requested order
+        if (hasBefore)
+            query = QStringLiteral("select * from (") + query + QStringLiteral(") order by ") + pkColumn + QStringLiteral(" ") + (isDescending ? QStringLiteral("desc") : QStringLiteral("asc"));
+        return query;
     }
 
-    if (!orderBy.isEmpty()) {
-        query.append(QString(QStringLiteral(" order by %1")).arg(orderBy));
-        if (!orderBy.contains(QStringLiteral("asc"), Qt::CaseInsensitive) || orderBy.contains(QStringLiteral("desc"), Qt::CaseInsensitive))
-            query.append(QStringLiteral(" ") + order);
+    if (!whereStr.isEmpty())
+        query.append(QStringLiteral(" where ")).append(whereStr);
+
+    if (!groupBy.isEmpty()) {
+        QStringList groupByExpressions;
+        foreach (const QString &column, groupBy)
+            groupByExpressions << columnExpression(tableName, column);
+        groupByExpressions.removeAll(QString());
+        query.append(QStringLiteral(" group by ") + groupByExpressions.join(QStringLiteral(", ")));
+    }
+
+    // the "orderby" is a column (or json path) list, each one optionally followed by "asc" or "desc"
+    bool isOrderSet = false;
+    QStringList orderByTerms;
+    QStringList termParts;
+    foreach (const QString &term, orderBy.split(QLatin1Char(','), QString::SkipEmptyParts)) {
+        termParts = term.simplified().split(QLatin1Char(' '));
+        if (termParts.size() > 2 || (termParts.size() == 2 && termParts.last().compare(QStringLiteral("asc"), Qt::CaseInsensitive) != 0
+                                     && termParts.last().compare(QStringLiteral("desc"), Qt::CaseInsensitive) != 0)
+                || identifiers(termParts.first()).isEmpty() || (expression = columnExpression(tableName, termParts.first())).isEmpty()) {
+            emit logMessage(QStringLiteral("Ignoring invalid orderby in select: ") + term);
+            continue;
+        }
+        orderByTerms << (termParts.size() == 2 ? expression + QStringLiteral(" ") + termParts.last().toLower() : expression);
+        isOrderSet = termParts.size() == 2;
     }
 
+    // the "order" direction is applied to the last term, if it has no direction
+    if (!orderByTerms.isEmpty())
+        query.append(QStringLiteral(" order by ") + orderByTerms.join(QStringLiteral(", ")) + (isOrderSet ? QString() : QStringLiteral(" ") + order));
+
     if (limit > 0 && offset == 0)
         query.append(QStringLiteral(" limit ") + QString::number(limit));
     else if (offset > 0)
         query.append(QStringLiteral(" limit ") + QString::number(limit) + QStringLiteral(" offset ") + QString::number(offset));
 
-    m_qsqlQuery.prepare(query);
-
-    foreach (const QString &key, where.keys())
-        m_qsqlQuery.addBindValue(withLikeClause ? QVariant("\%"+where.value(key).toString()+"\%") : where.value(key));
+    return query;
+}
 
-    if (!m_qsqlQuery.exec())
-        return resultSet;
+QStringList Database::identifiers(const QVariant &value, bool acceptAll)
+{
+    // the value can be a string, a comma separated string or a list of strings
+    QStringList names;
+    if (value.userType() == QMetaType::QVariantList || value.userType() == QMetaType::QStringList)
+        names = value.toStringList();
+    else if (!value.toString().isEmpty())
+        names = value.toString().split(QLatin1Char(','));
 
-    emit logMessage(QStringLiteral("Query success executed: ") + query);
+    QStringList identifiers;
+    // a column name, a column qualified by the table name or a json path, like "profile.address.city" or "tags.0"
+    QRegExp identifier(QStringLiteral("[A-Za-z_][A-Za-z0-9_]*(\\.[A-Za-z0-9_]+)*"));
+    foreach (const QString &name, names) {
+        if ((acceptAll && name.trimmed() == QStringLiteral("*")) || identifier.exactMatch(name.trimmed()))
+            identifiers << name.trimmed();
+        else
+            emit logMessage(QStringLiteral("Ignoring invalid column name in select: ") + name);
+    }
+    return identifiers;
+}
 
-    int totalColumns = m_qsqlQuery.record().count();
-    if (!totalColumns || !m_qsqlQuery.size())
-        return resultSet;
+QString Database::columnExpression(const QString &tableName, const QString &key)
+{
+    QStringList path(key.split(QLatin1Char('.')));
+    // a column name or a column qualified by the table name, like "messages.id"
+    if (path.size() == 1 || (path.size() == 2 && path.first() == tableName))
+        return key;
 
-    return this->resultSet(selectType);
+    // the path is put in the query string (and not bound), because sqlite uses the
+    // expression index only if the query has the same expression of the index
+    QString jsonPath(QStringLiteral("$"));
+    QRegExp number(QStringLiteral("[0-9]+"));
+    QRegExp name(QStringLiteral("[A-Za-z_][A-Za-z0-9_]*"));
+    QString column(path.takeFirst());
+    // the CBOR columns are blobs, and sqlite json functions cannot read it
+    if (cborColumns(tableName).contains(column)) {
+        emit logMessage(QStringLiteral("Ignoring json path in the CBOR column: ") + key);
+        return QString();
+    }
+    foreach (const QString &segment, path) {
+        if (number.exactMatch(segment)) {
+            jsonPath += QStringLiteral("[") + segment + QStringLiteral("]");
+        } else if (name.exactMatch(segment)) {
+            jsonPath += QStringLiteral(".") + segment;
+        } else {
+            emit logMessage(QStringLiteral("Ignoring invalid json path: ") + key);
+            return QString();
+        }
+    }
+    return QStringLiteral("json_extract(") + column + QStringLiteral(", '") + jsonPath + QStringLiteral("')");
 }
 
-int Database::insert(const QString &tableName, const QVariantMap &insertData)
+bool Database::setCborColumns(const QString &tableName, const QStringList &columns)
 {
-    if (tableName.isEmpty()) {
-        emit logMessage(QStringLiteral("Fatal error on try insert: The table name is empty!"));
-        return 0;
-    } else if (insertData.isEmpty()) {
-        emit logMessage(QStringLiteral("Fatal error on try insert: The insertData is empty!"));
-        return 0;
+    QStringList cborColumns(identifiers(columns));
+    if (tableName.isEmpty() || cborColumns.size() != columns.size()) {
+        emit logMessage(QStringLiteral("Fatal error on try set CBOR columns: Invalid table or columns names for '") + tableName + QStringLiteral("'"));
+        return false;
     }
+#if QT_VERSION < QT_VERSION_CHECK(5, 12, 0)
+    if (!cborColumns.isEmpty()) {
+        emit logMessage(QStringLiteral("The CBOR format needs Qt 5.12, the columns of '") + tableName + QStringLiteral("' are saved as json!"));
+        return false;
+    }
+#endif
 
-    QStringList strValues;
-    QStringList fields(insertData.keys());
-    QVariantList values(insertData.values());
-    int totalFields = fields.size();
-    for (int i = 0; i < totalFields; ++i)
-        strValues.append(QStringLiteral("?"));
+    QStringList previousColumns(this->cborColumns(tableName));
+    if (previousColumns == cborColumns)
+        return true;
 
     openConnection();
 
-    QString query(QStringLiteral("INSERT INTO ") + tableName + QStringLiteral("(") + QString(fields.join(QStringLiteral(","))) + QStringLiteral(") VALUES(") + QString(strValues.join(QStringLiteral(","))) + QStringLiteral(")"));
-    m_qsqlQuery.prepare(query);
+    // a json index (see createJsonIndex) cannot read the CBOR blobs, so each write in the column would fail
+    QSqlQuery *sqlQuery = defaultQuery();
+    sqlQuery->prepare(QStringLiteral("SELECT count(*) FROM sqlite_master WHERE type = 'index' AND tbl_name = ? AND sql LIKE ?"));
+    foreach (const QString &column, cborColumns) {
+        if (previousColumns.contains(column))
+            continue;
+        sqlQuery->bindValue(0, tableName);
+        sqlQuery->bindValue(1, QStringLiteral("%json_extract(") + column + QStringLiteral(",%"));
+        bool hasJsonIndex = execStatement(sqlQuery) && sqlQuery->next() && sqlQuery->value(0).toInt() > 0;
+        sqlQuery->finish();
+        if (hasJsonIndex) {
+            emit logMessage(QStringLiteral("Fatal error on try set CBOR columns: The column '") + column + QStringLiteral("' of '") + tableName + QStringLiteral("' has a json index!"));
+            return false;
+        }
+    }
 
-    int k = 0;
-    foreach (const QVariant &value, values)
-        m_qsqlQuery.bindValue(k++, value);
+    // the new CBOR columns are converted from json, and the removed columns back to json
+    QStringList convertColumns(cborColumns);
+    foreach (const QString &column, previousColumns) {
+        if (!convertColumns.contains(column))
+            convertColumns << column;
+    }
+
+    if (!queryExec(QStringLiteral("BEGIN IMMEDIATE TRANSACTION"))) {
+        emit logMessage(QStringLiteral("Fatal error on try begin CBOR conversion transaction: ") + lastError());
+        return false;
+    }
 
-    if (m_qsqlQuery.exec())
-        return lastInsertId();
+    bool ok = queryExec(QStringLiteral("CREATE TABLE IF NOT EXISTS storage_formats (table_name TEXT PRIMARY KEY NOT NULL, cbor_columns TEXT NOT NULL)"));
 
-    QString error(lastError());
-    if (!error.isEmpty()) {
-        error.prepend(QStringLiteral("Fatal error on try insert: "));
-        emit logMessage(error);
+    // the rows are read by a separated statement, while the update statement write the converted values
+    QSqlQuery reader(QSqlDatabase::database(m_connectionPool->connection()->name));
+    reader.setForwardOnly(true);
+    ok = ok && execStatement(&reader, QStringLiteral("SELECT rowid, ") + convertColumns.join(QStringLiteral(", ")) + QStringLiteral(" FROM ") + tableName);
+
+    QSqlQuery *writer = defaultQuery();
+    ok = ok && writer->prepare(QStringLiteral("UPDATE ") + tableName + QStringLiteral(" SET ") + convertColumns.join(QStringLiteral(" = ?, ")) + QStringLiteral(" = ? WHERE rowid = ?"));
+
+    int i = 0;
+    int converted = 0;
+    int totalColumns = convertColumns.size();
+    bool isChanged = false;
+    QVariant value;
+    QVariant convertedValue;
+    while (ok && reader.next()) {
+        isChanged = false;
+        for (i = 0; i < totalColumns; ++i) {
+            value = reader.value(i + 1);
+            convertedValue = convertDocument(value, cborColumns.contains(convertColumns.at(i)));
+            isChanged = isChanged || convertedValue.userType() != value.userType();
+            writer->bindValue(i, convertedValue);
+        }
+        // the rows already in the target format are not written again
+        if (!isChanged)
+            continue;
+        writer->bindValue(totalColumns, reader.value(0));
+        ok = execStatement(writer, QString(), false);
+        ++converted;
     }
+    reader.finish();
 
-    return 0;
+    if (ok) {
+        writer->prepare(QStringLiteral("INSERT OR REPLACE INTO storage_formats (table_name, cbor_columns) VALUES (?, ?)"));
+        writer->bindValue(0, tableName);
+        writer->bindValue(1, cborColumns.join(QStringLiteral(",")));
+        ok = execStatement(writer) && queryExec(QStringLiteral("COMMIT"));
+    }
+    if (!ok) {
+        emit logMessage(QStringLiteral("Fatal error on try convert the CBOR columns of '") + tableName + QStringLiteral("': ") + lastError());
+        queryExec(QStringLiteral("ROLLBACK"));
+        return false;
+    }
+    emit logMessage(QString(QStringLiteral("The CBOR columns of '%1' was set to '%2', %3 rows converted")).arg(tableName, cborColumns.join(QStringLiteral(","))).arg(converted));
+
+    // the cached rows are decoded from the previous format
+    m_resultCache->invalidate(tableName);
+
+    QMutexLocker locker(&m_cborMutex);
+    m_cborColumns.insert(tableName, cborColumns);
+    return true;
 }
 
-int Database::remove(const QString &tableName, const QVariantMap &where, const QString &whereComparator)
+QStringList Database::cborColumns(const QString &tableName)
 {
-    if (tableName.isEmpty()) {
-        emit logMessage(QStringLiteral("Fatal error on try remove item: The table name is empty!"));
-        return 0;
-    } else if (where.isEmpty()) {
-        emit logMessage(QStringLiteral("Fatal error on try remove item: The where parameter is empty!"));
-        return 0;
-    }
+    QMutexLocker locker(&m_cborMutex);
+    if (m_cborColumns.contains(tableName))
+        return m_cborColumns.value(tableName);
+    locker.unlock();
 
-    int k = 0;
-    QString whereStr;
-    QString separator;
-
-    QMap<QString, QVariant>::const_iterator j = where.constBegin();
-    while (j != where.constEnd()) {
-        separator = (k++ == 0) ? QStringLiteral("") : QStringLiteral(" AND ");
-        whereStr += QString("%1%2 %3 '%4'").arg(separator).arg(j.key()).arg(whereComparator).arg(j.value().toString());
-        ++j;
-    }
+    openConnection();
 
-    QString query(QStringLiteral("DELETE FROM ") + tableName);
+    QStringList columns;
+    QString cacheKey(QStringLiteral("cbor_columns"));
+    QSqlQuery *sqlQuery = cachedStatement(cacheKey);
+    if (!sqlQuery)
+        sqlQuery = prepareStatement(cacheKey, QStringLiteral("SELECT cbor_columns FROM storage_formats WHERE table_name = ?"));
 
-    if (!where.isEmpty())
-        query.append(QStringLiteral(" WHERE ") + whereStr);
+    // if the metadata table does not exists, all columns are saved as json
+    sqlQuery->bindValue(0, tableName);
+    if (sqlQuery->exec() && sqlQuery->next())
+        columns = sqlQuery->value(0).toString().split(QLatin1Char(','), QString::SkipEmptyParts);
+    sqlQuery->finish();
 
-    return queryExec(query) ? numRowsAffected() : 0;
+    locker.relock();
+    m_cborColumns.insert(tableName, columns);
+    return columns;
 }
 
-int Database::update(const QString &tableName, const QVariantMap &updateData, const QVariantMap &where, const QVariantMap &args)
+QVariantMap Database::storageBenchmark(const QString &tableName, const QString &column, int rows)
 {
-    if (tableName.isEmpty()) {
-        emit logMessage(QStringLiteral("Fatal error on try update: The table name is empty!"));
-        return 0;
-    } else if (where.empty()) {
-        emit logMessage(QStringLiteral("Fatal error on try update: The WHERE parameter must be set to update operation!"));
-        return 0;
-    }
+    QVariantMap result;
+    QVariantMap args;
+    args.insert(QStringLiteral("columns"), column);
+    args.insert(QStringLiteral("limit"), qMax(1, rows));
 
-    QString whereStr;
-    QString updateValues;
+    // the values are read as saved, without decode the CBOR blobs
+    QVariantList documents;
+    QSqlQuery *sqlQuery = selectCursor(tableName, QVariantMap(), args);
+    if (!sqlQuery)
+        return result;
+    while (sqlQuery->next())
+        documents << convertDocument(sqlQuery->value(0), false);
+    sqlQuery->finish();
+
+    // each format encode the same decoded values and decode your own encoded values
     QVariantList values;
+    foreach (const QVariant &document, documents)
+        values << QJsonDocument::fromJson(document.toByteArray()).toVariant();
 
-    const QString &whereOperator(args.value(QStringLiteral("whereOperator")).toString());
-    const QString &whereComparator(args.value(QStringLiteral("whereComparator")).toString());
+    QElapsedTimer timer;
+    QList<QByteArray> encoded;
+    qint64 bytes = 0;
+    QVariantMap format;
+    const QStringList formats({QStringLiteral("json"), QStringLiteral("cbor")});
+    foreach (const QString &formatName, formats) {
+        bool isCbor = formatName == QStringLiteral("cbor");
+        encoded.clear();
+        bytes = 0;
+        timer.start();
+        foreach (const QVariant &value, values)
+            encoded << (isCbor ? encodeCbor(value) : QJsonDocument::fromVariant(value).toJson(QJsonDocument::Compact));
+        format.insert(QStringLiteral("encodeMs"), timer.nsecsElapsed() / 1000000.0);
 
-    {
-        int k = 0;
-        QString key;
-        QString separator;
-        QMap<QString, QVariant>::const_iterator i = updateData.constBegin();
-        while (i != updateData.constEnd()) {
-            key = i.key();
-            separator = (k++ == 0) ? QStringLiteral("") : QStringLiteral(",");
-            updateValues.append(QString("%1%2=%3").arg(separator, key, ":"+key));
-            values << i.value();
-            ++i;
+        timer.start();
+        foreach (const QByteArray &value, encoded) {
+            bytes += value.size();
+            if (isCbor)
+                decodeValue(value);
+            else
+                QJsonDocument::fromJson(value).toVariant();
         }
+        format.insert(QStringLiteral("decodeMs"), timer.nsecsElapsed() / 1000000.0);
+        format.insert(QStringLiteral("bytes"), bytes);
+        result.insert(formatName, format);
+    }
+    result.insert(QStringLiteral("rows"), values.size());
+    return result;
+}
 
-        k = 0;
-        separator = "";
-        i = where.constBegin();
-        while (i != where.constEnd()) {
-            key = i.key();
-            separator = (k++ == 0) ? QStringLiteral("") : (QStringLiteral(" ") + whereOperator + QStringLiteral(" "));
-            whereStr += QString("%1%2%3%4").arg(separator, key, whereComparator, ":"+key);
+QByteArray Database::encodeCbor(const QVariant &value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    return QCborValue(QCborKnownTags::Signature, QCborValue::fromVariant(value)).toCbor();
+#else
+    Q_UNUSED(value)
+    return QByteArray();
+#endif
+}
+
+bool Database::isJsonDocument(const QByteArray &value)
+{
+    // skip the leading whitespaces to check the first json char
+    int size = value.size();
+    for (int i = 0; i < size; ++i) {
+        if (value.at(i) == '{' || value.at(i) == '[')
+            return true;
+        if (value.at(i) != ' ' && value.at(i) != '\n' && value.at(i) != '\r' && value.at(i) != '\t')
+            return false;
+    }
+    return false;
+}
+
+bool Database::isCborDocument(const QByteArray &value)
+{
+    return value.size() > 3 && static_cast<uchar>(value.at(0)) == 0xD9 && static_cast<uchar>(value.at(1)) == 0xD9 && static_cast<uchar>(value.at(2)) == 0xF7;
+}
+
+QVariant Database::decodeValue(const QVariant &value)
+{
+    // only the blobs are checked, the json text values are QString
+    if (value.userType() != QMetaType::QByteArray)
+        return value;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    QByteArray bytes(value.toByteArray());
+    if (isCborDocument(bytes))
+        return QCborValue::fromCbor(bytes).taggedValue().toVariant();
+#endif
+    return value;
+}
+
+QVariant Database::convertDocument(const QVariant &value, bool toCbor)
+{
+    if (value.isNull())
+        return value;
+    QByteArray bytes(value.toByteArray());
+    if (toCbor) {
+        if (value.userType() == QMetaType::QByteArray || !isJsonDocument(bytes))
+            return value;
+        QJsonParseError jsonParseError;
+        QJsonDocument json(QJsonDocument::fromJson(bytes, &jsonParseError));
+        if (jsonParseError.error != QJsonParseError::NoError)
+            return value;
+        return encodeCbor(json.toVariant());
+    }
+    QVariant decodedValue(decodeValue(value));
+    // without CBOR support the blob is not decoded and is kept as is
+    if (decodedValue.userType() == QMetaType::QByteArray)
+        return value;
+    return QString::fromUtf8(QJsonDocument::fromVariant(decodedValue).toJson(QJsonDocument::Compact));
+}
+
+bool Database::createJsonIndex(const QString &tableName, const QString &jsonPath)
+{
+    QString expression(identifiers(jsonPath).size() == 1 ? columnExpression(tableName, jsonPath) : QString());
+    if (tableName.isEmpty() || expression.isEmpty() || expression == jsonPath) {
+        emit logMessage(QStringLiteral("Fatal error on try create json index: Invalid json path '") + jsonPath + QStringLiteral("'"));
+        return false;
+    }
+    QString indexName(tableName + QStringLiteral("_") + QString(jsonPath).replace(QLatin1Char('.'), QLatin1Char('_')) + QStringLiteral("_index"));
+    return queryExec(QStringLiteral("CREATE INDEX IF NOT EXISTS ") + indexName + QStringLiteral(" ON ") + tableName + QStringLiteral("(") + expression + QStringLiteral(")"));
+}
+
+QVariantMap Database::selectPage(const QString &tableName, const QVariantMap &where, const QVariantMap &args)
+{
+    QVariantMap pageArgs(args);
+    QString pkColumn(this->pkColumn(args));
+    // without token, select the first page
+    if (!pageArgs.contains(QStringLiteral("after")) && !pageArgs.contains(QStringLiteral("before")))
+        pageArgs.insert(QStringLiteral("after"), QString());
+
+    QVariantList items(select(tableName, where, pageArgs));
+    QVariantMap page(pageTokens(pageArgs, items.size(), items.isEmpty() ? QVariant() : items.first().toMap().value(pkColumn),
+                                items.isEmpty() ? QVariant() : items.last().toMap().value(pkColumn)));
+    page.insert(QStringLiteral("items"), items);
+    return page;
+}
+
+QVariantMap Database::pageTokens(const QVariantMap &args, int rows, const QVariant &firstPk, const QVariant &lastPk)
+{
+    int limit = args.value(QStringLiteral("limit"), -1).toInt();
+    bool isFullPage = limit > 0 && rows >= limit;
+    bool isBefore = !args.contains(QStringLiteral("after"));
+    bool isFirstPage = !isBefore && args.value(QStringLiteral("after")).toString().isEmpty();
+
+    // the 'next' token is empty at the end of the table and the 'previous' token is empty at the begin of the table
+    bool hasNext = rows > 0 && (isBefore || isFullPage);
+    bool hasPrevious = rows > 0 && !isFirstPage && (!isBefore || isFullPage);
+
+    QVariantMap tokens;
+    tokens.insert(QStringLiteral("next"), hasNext ? encodePageToken(lastPk) : QString());
+    tokens.insert(QStringLiteral("previous"), hasPrevious ? encodePageToken(firstPk) : QString());
+    return tokens;
+}
+
+QString Database::pkColumn(const QVariantMap &args)
+{
+    // the keyset column is a plain column name, not a json path
+    QStringList names(identifiers(args.value(QStringLiteral("pkColumn"), QStringLiteral("id"))));
+    if (names.size() != 1 || names.first().contains(QLatin1Char('.'))) {
+        emit logMessage(QStringLiteral("Fatal error on try select a page: invalid pkColumn ") + args.value(QStringLiteral("pkColumn")).toString());
+        return QString();
+    }
+    return names.first();
+}
+
+QString Database::encodePageToken(const QVariant &pkValue)
+{
+    if (!pkValue.isValid())
+        return QString();
+    QJsonArray json;
+    json.append(QJsonValue::fromVariant(pkValue));
+    return QString::fromLatin1(QJsonDocument(json).toJson(QJsonDocument::Compact).toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
+
+QVariant Database::decodePageToken(const QString &token)
+{
+    if (token.isEmpty())
+        return QVariant();
+    QJsonDocument json(QJsonDocument::fromJson(QByteArray::fromBase64(token.toLatin1(), QByteArray::Base64UrlEncoding)));
+    if (!json.isArray() || json.array().isEmpty())
+        return QVariant();
+    return json.array().first().toVariant();
+}
+
+int Database::insert(const QString &tableName, const QVariantMap &insertData, bool ignoreConflicts)
+{
+    if (tableName.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try insert: The table name is empty!"));
+        return 0;
+    } else if (insertData.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try insert: The insertData is empty!"));
+        return 0;
+    }
+
+    QVariantList values(insertData.values());
+
+    openConnection();
+
+    QSqlQuery *sqlQuery = insertStatement(tableName, insertData.keys(), ignoreConflicts);
+
+    int k = 0;
+    foreach (const QVariant &value, values)
+        sqlQuery->bindValue(k++, value);
+
+    // a ignored row does not change the last insert id, so check the affected rows
+    if (execStatement(sqlQuery)) {
+        if (ignoreConflicts && sqlQuery->numRowsAffected() < 1)
+            return 0;
+        int insertId = lastInsertId();
+        trackChange(tableName, QStringLiteral("insert"), insertData, QVariantMap(), QVariantList() << insertId);
+        return insertId;
+    }
+
+    QString error(lastError());
+    if (!error.isEmpty()) {
+        error.prepend(QStringLiteral("Fatal error on try insert: "));
+        emit logMessage(error);
+    }
+
+    return 0;
+}
+
+QVariantMap Database::insertBatch(const QString &tableName, const QVariantList &rows, bool ignoreConflicts)
+{
+    int inserted = 0;
+    int ignored = 0;
+    int total = rows.size();
+    QVariantList ids;
+    QVariantMap result;
+    result.insert(QStringLiteral("inserted"), 0);
+    result.insert(QStringLiteral("ignored"), 0);
+    result.insert(QStringLiteral("failed"), total);
+    result.insert(QStringLiteral("ids"), ids);
+
+    if (tableName.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try insert batch: The table name is empty!"));
+        return result;
+    } else if (!total) {
+        return result;
+    }
+
+    if (!openConnection() || !transaction(true)) {
+        emit logMessage(QStringLiteral("Fatal error on try insert batch: ") + lastError());
+        return result;
+    }
+
+    int k = 0;
+    QVariantMap row;
+    QSqlQuery *sqlQuery = nullptr;
+    QStringList fields;
+    QStringList lastFields;
+    ids.reserve(total);
+
+    for (int i = 0; i < total; ++i) {
+        row = rows.at(i).toMap();
+        if (!row.isEmpty()) {
+            // the rows with the same columns of the previous row reuse the same prepared statement
+            fields = row.keys();
+            if (!sqlQuery || fields != lastFields) {
+                sqlQuery = insertStatement(tableName, fields, ignoreConflicts);
+                lastFields = fields;
+            }
+
+            k = 0;
+            foreach (const QVariant &value, row)
+                sqlQuery->bindValue(k++, value);
+
+            if (execStatement(sqlQuery)) {
+                if (ignoreConflicts && sqlQuery->numRowsAffected() < 1) {
+                    ++ignored;
+                } else {
+                    ids << sqlQuery->lastInsertId();
+                    ++inserted;
+                    trackChange(tableName, QStringLiteral("insert"), row, QVariantMap(), QVariantList() << ids.last());
+                }
+            } else {
+                emit logMessage(QStringLiteral("Error on try insert batch row: ") + sqlQuery->lastError().text());
+            }
+        }
+        if ((i + 1) % 500 == 0)
+            emit batchProgress(tableName, i + 1, total);
+    }
+
+    if (!commit()) {
+        emit logMessage(QStringLiteral("Fatal error on try commit insert batch: ") + lastError());
+        rollback();
+        return result;
+    }
+
+    if (total % 500 != 0)
+        emit batchProgress(tableName, total, total);
+    emit logMessage(QString(QStringLiteral("Insert batch in '%1': %2 of %3 rows inserted, %4 ignored")).arg(tableName).arg(inserted).arg(total).arg(ignored));
+
+    result.insert(QStringLiteral("inserted"), inserted);
+    result.insert(QStringLiteral("ignored"), ignored);
+    result.insert(QStringLiteral("failed"), total - inserted - ignored);
+    result.insert(QStringLiteral("ids"), ids);
+    return result;
+}
+
+QSqlQuery *Database::insertStatement(const QString &tableName, const QStringList &fields, bool ignoreConflicts)
+{
+    // the insert query is build and prepared only if is not in the statements cache
+    QString cacheKey((ignoreConflicts ? QStringLiteral("insert_ignore:") : QStringLiteral("insert:")) + tableName + QStringLiteral(":") + fields.join(QStringLiteral(",")));
+    QSqlQuery *sqlQuery = cachedStatement(cacheKey);
+    if (sqlQuery)
+        return sqlQuery;
+
+    QStringList strValues;
+    int totalFields = fields.size();
+    for (int i = 0; i < totalFields; ++i)
+        strValues.append(QStringLiteral("?"));
+    QString query(QStringLiteral("INSERT INTO ") + tableName + QStringLiteral("(") + QString(fields.join(QStringLiteral(","))) + QStringLiteral(") VALUES(") + QString(strValues.join(QStringLiteral(","))) + QStringLiteral(")"));
+
+    // only the duplicated primary keys are ignored. 'INSERT OR IGNORE' skip the rows
+    // that fails the NOT NULL and CHECK constraints too, without any error
+    if (ignoreConflicts) {
+        QStringList pkColumns(primaryKeyColumns(tableName));
+        if (pkColumns.isEmpty())
+            query.append(QStringLiteral(" ON CONFLICT DO NOTHING"));
+        else
+            query.append(QStringLiteral(" ON CONFLICT(") + pkColumns.join(QStringLiteral(",")) + QStringLiteral(") DO NOTHING"));
+    }
+    return prepareStatement(cacheKey, query);
+}
+
+QStringList Database::primaryKeyColumns(const QString &tableName)
+{
+    int dot = tableName.indexOf(QLatin1Char('.'));
+    if (dot > 0)
+        queryExec(QStringLiteral("PRAGMA ") + tableName.left(dot) + QStringLiteral(".table_info(") + tableName.mid(dot + 1) + QStringLiteral(");"));
+    else
+        queryExec(QStringLiteral("PRAGMA table_info(") + tableName + QStringLiteral(");"));
+
+    // the "pk" field is the column position in the primary key, or zero
+    QMap<int, QString> pkColumns;
+    QVariantMap column;
+    foreach (const QVariant &item, resultSet()) {
+        column = item.toMap();
+        if (column.value(QStringLiteral("pk")).toInt() > 0)
+            pkColumns.insert(column.value(QStringLiteral("pk")).toInt(), column.value(QStringLiteral("name")).toString());
+    }
+    return pkColumns.values();
+}
+
+int Database::upsert(const QString &tableName, const QVariantMap &data, const QStringList &conflictColumns)
+{
+    if (tableName.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try upsert: The table name is empty!"));
+        return 0;
+    } else if (data.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try upsert: The data is empty!"));
+        return 0;
+    }
+
+    openConnection();
+
+    QSqlQuery *sqlQuery = upsertStatement(tableName, data.keys(), conflictColumns.isEmpty() ? QStringList(QStringLiteral("id")) : conflictColumns);
+
+    int k = 0;
+    foreach (const QVariant &value, data)
+        sqlQuery->bindValue(k++, value);
+
+    if (execStatement(sqlQuery)) {
+        int affected = sqlQuery->numRowsAffected();
+        if (affected > 0)
+            trackChange(tableName, QStringLiteral("upsert"), data, QVariantMap(), upsertedRowId(tableName, data, conflictColumns.isEmpty() ? QStringList(QStringLiteral("id")) : conflictColumns));
+        return affected;
+    }
+
+    emit logMessage(QStringLiteral("Fatal error on try upsert: ") + sqlQuery->lastError().text());
+    return 0;
+}
+
+QVariantMap Database::upsertBatch(const QString &tableName, const QVariantList &rows, const QStringList &conflictColumns)
+{
+    int affected = 0;
+    int failed = 0;
+    int total = rows.size();
+    QVariantMap result;
+    result.insert(QStringLiteral("affected"), 0);
+    result.insert(QStringLiteral("failed"), total);
+
+    if (tableName.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try upsert batch: The table name is empty!"));
+        return result;
+    } else if (!total) {
+        return result;
+    }
+
+    if (!openConnection() || !transaction(true)) {
+        emit logMessage(QStringLiteral("Fatal error on try upsert batch: ") + lastError());
+        return result;
+    }
+
+    int k = 0;
+    QVariantMap row;
+    QSqlQuery *sqlQuery = nullptr;
+    QStringList conflict(conflictColumns.isEmpty() ? QStringList(QStringLiteral("id")) : conflictColumns);
+
+    for (int i = 0; i < total; ++i) {
+        row = rows.at(i).toMap();
+        if (!row.isEmpty()) {
+            // the rowid lookup of the previous row (see upsertedRowId) can evict the cached statement, or re-prepare
+            // the default query when the cache is disabled, so the statement is fetched again for each row
+            sqlQuery = upsertStatement(tableName, row.keys(), conflict);
+
+            k = 0;
+            foreach (const QVariant &value, row)
+                sqlQuery->bindValue(k++, value);
+
+            if (execStatement(sqlQuery)) {
+                if (sqlQuery->numRowsAffected() > 0) {
+                    affected += sqlQuery->numRowsAffected();
+                    trackChange(tableName, QStringLiteral("upsert"), row, QVariantMap(), upsertedRowId(tableName, row, conflict));
+                }
+            } else {
+                ++failed;
+                emit logMessage(QStringLiteral("Error on try upsert batch row: ") + sqlQuery->lastError().text());
+            }
+        } else {
+            ++failed;
+        }
+        if ((i + 1) % 500 == 0)
+            emit batchProgress(tableName, i + 1, total);
+    }
+
+    if (!commit()) {
+        emit logMessage(QStringLiteral("Fatal error on try commit upsert batch: ") + lastError());
+        rollback();
+        return result;
+    }
+
+    if (total % 500 != 0)
+        emit batchProgress(tableName, total, total);
+    emit logMessage(QString(QStringLiteral("Upsert batch in '%1': %2 of %3 rows saved")).arg(tableName).arg(affected).arg(total));
+
+    result.insert(QStringLiteral("affected"), affected);
+    result.insert(QStringLiteral("failed"), failed);
+    return result;
+}
+
+QSqlQuery *Database::upsertStatement(const QString &tableName, const QStringList &fields, const QStringList &conflictColumns)
+{
+    // the upsert query is build and prepared only if is not in the statements cache
+    QString cacheKey(QStringLiteral("upsert:") + tableName + QStringLiteral(":") + fields.join(QStringLiteral(",")) + QStringLiteral(":") + conflictColumns.join(QStringLiteral(",")));
+    QSqlQuery *sqlQuery = cachedStatement(cacheKey);
+    if (sqlQuery)
+        return sqlQuery;
+
+    QStringList strValues;
+    QStringList strUpdate;
+    foreach (const QString &field, fields) {
+        strValues.append(QStringLiteral("?"));
+        if (!conflictColumns.contains(field))
+            strUpdate.append(field + QStringLiteral(" = excluded.") + field);
+    }
+    QString query(QStringLiteral("INSERT INTO ") + tableName + QStringLiteral("(") + fields.join(QStringLiteral(",")) + QStringLiteral(") VALUES(") + strValues.join(QStringLiteral(",")) + QStringLiteral(")"));
+    query.append(QStringLiteral(" ON CONFLICT(") + conflictColumns.join(QStringLiteral(",")) + QStringLiteral(")"));
+    query.append(strUpdate.isEmpty() ? QStringLiteral(" DO NOTHING") : QStringLiteral(" DO UPDATE SET ") + strUpdate.join(QStringLiteral(",")));
+    return prepareStatement(cacheKey, query);
+}
+
+int Database::importJson(const QString &tableName, const QUrl &url, const QVariantMap &options)
+{
+    int importId = m_lastImportId.fetchAndAddOrdered(1) + 1;
+    JsonImporter *importer = new JsonImporter(importId, tableName, options);
+
+    if (url.scheme() == QStringLiteral("http") || url.scheme() == QStringLiteral("https")) {
+        // the reply is read while is downloading, instead of wait the full response
+        QNetworkRequest request(url);
+        QVariantMap headers(options.value(QStringLiteral("headers")).toMap());
+        QVariantMap::const_iterator i = headers.constBegin();
+        for (; i != headers.constEnd(); ++i)
+            request.setRawHeader(i.key().toUtf8(), i.value().toByteArray());
+        QNetworkAccessManager *networkManager = new QNetworkAccessManager(importer);
+        importer->setReply(networkManager->get(request));
+    } else if (url.scheme() == QStringLiteral("qrc")) {
+        importer->setFileName(QStringLiteral(":") + url.path());
+    } else {
+        // a file url or a plain file path
+        importer->setFileName(url.isLocalFile() ? url.toLocalFile() : url.toString());
+    }
+    return startImport(importId, importer);
+}
+
+int Database::importJson(const QString &tableName, QIODevice *device, const QVariantMap &options)
+{
+    int importId = m_lastImportId.fetchAndAddOrdered(1) + 1;
+    JsonImporter *importer = new JsonImporter(importId, tableName, options);
+    importer->setDevice(device);
+    return startImport(importId, importer);
+}
+
+int Database::startImport(int importId, JsonImporter *importer)
+{
+    connect(importer, &JsonImporter::progress, this, &Database::importProgress);
+    connect(importer, &JsonImporter::importFinished, this, [this](int finishedId, const QString &tableName, const QVariantMap &result) {
+        m_imports.remove(finishedId);
+        emit logMessage(QString(QStringLiteral("Json import in '%1': %2 rows read, %3 saved, %4 ignored, %5 failed %6")).arg(tableName)
+                        .arg(result.value(QStringLiteral("rows")).toInt()).arg(result.value(QStringLiteral("inserted")).toInt())
+                        .arg(result.value(QStringLiteral("ignored")).toInt()).arg(result.value(QStringLiteral("failed")).toInt())
+                        .arg(result.value(QStringLiteral("error")).toString()));
+        emit importFinished(finishedId, tableName, result);
+    });
+    connect(importer, &JsonImporter::finished, importer, &JsonImporter::deleteLater);
+    addDedicatedThread(importer);
+    m_imports.insert(importId, importer);
+    importer->start();
+    return importId;
+}
+
+void Database::cancelImport(int importId)
+{
+    QPointer<JsonImporter> importer(m_imports.value(importId));
+    if (importer)
+        importer->cancel();
+}
+
+bool Database::contains(const QString &tableName, const QString &column, const QVariant &value)
+{
+    if (tableName.isEmpty() || column.isEmpty() || !value.isValid())
+        return false;
+
+    openConnection();
+
+    QString cacheKey(QStringLiteral("contains:") + tableName + QStringLiteral(":") + column);
+    QSqlQuery *sqlQuery = cachedStatement(cacheKey);
+    if (!sqlQuery)
+        sqlQuery = prepareStatement(cacheKey, QStringLiteral("SELECT 1 FROM ") + tableName + QStringLiteral(" WHERE ") + column + QStringLiteral(" = ? LIMIT 1"));
+
+    sqlQuery->bindValue(0, value);
+    if (!execStatement(sqlQuery)) {
+        emit logMessage(QStringLiteral("Error on check if table contains value: ") + sqlQuery->lastError().text());
+        return false;
+    }
+    bool found = sqlQuery->next();
+    sqlQuery->finish();
+    return found;
+}
+
+int Database::count(const QString &tableName, const QVariantMap &where, const QVariantMap &args)
+{
+    if (tableName.isEmpty())
+        return 0;
+    // only the number of rows is read from database
+    QVariantMap countArgs(args);
+    countArgs.insert(QStringLiteral("count"), QStringLiteral("*"));
+    countArgs.remove(QStringLiteral("columns"));
+    countArgs.remove(QStringLiteral("groupBy"));
+    QVariantList result(select(tableName, where, countArgs));
+    return result.isEmpty() ? 0 : result.first().toMap().value(QStringLiteral("count")).toInt();
+}
+
+QVariantList Database::search(const QString &tableName, const QString &text, const QVariantMap &where, const QVariantMap &args)
+{
+    QVariantList resultSet;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlQuery *sqlQuery = searchCursor(tableName, text, where, args);
+    if (!sqlQuery)
+        return resultSet;
+
+    resultSet = this->resultSet();
+    profileQuery(sqlQuery, timer.nsecsElapsed(), resultSet.size());
+    sqlQuery->finish();
+    return resultSet;
+}
+
+QSqlQuery *Database::searchCursor(const QString &tableName, const QString &text, const QVariantMap &where, const QVariantMap &args)
+{
+    if (tableName.isEmpty() || !openConnection())
+        return nullptr;
+
+    QVariantList values;
+    QString query(searchQueryString(tableName, text, where, args, &values));
+    if (query.isEmpty())
+        return nullptr;
+
+    // the generated query is the statement cache key
+    QSqlQuery *sqlQuery = cachedStatement(query);
+    if (!sqlQuery)
+        sqlQuery = prepareStatement(query, query);
+
+    int k = 0;
+    foreach (const QVariant &value, values)
+        sqlQuery->bindValue(k++, value);
+
+    // the caller profile the query after read the rows
+    if (!execStatement(sqlQuery, QString(), false)) {
+        emit logMessage(QStringLiteral("Fatal error on try search: ") + sqlQuery->lastError().text());
+        return nullptr;
+    }
+    return sqlQuery;
+}
+
+QString Database::searchQueryString(const QString &tableName, const QString &text, const QVariantMap &where, const QVariantMap &args, QVariantList *bindValues)
+{
+    SearchIndex index(searchIndex(tableName));
+    if (index.columns.isEmpty()) {
+        emit logMessage(QStringLiteral("Error on try search: The table '") + tableName + QStringLiteral("' has no search index!"));
+        return QString();
+    }
+
+    QString query;
+    if (index.isFts) {
+        QString match(searchMatchString(text));
+        if (match.isEmpty())
+            return QString();
+        // the FTS5 table is the first in the join, so sqlite read only the matched rowids from the index
+        QString ftsTable(tableName + QStringLiteral("_fts"));
+        query = QStringLiteral("select ") + tableName + QStringLiteral(".*, snippet(") + ftsTable + QStringLiteral(", -1, '<b>', '</b>', '...', 12) as snippet, ")
+                + ftsTable + QStringLiteral(".rank as rank from ") + ftsTable + QStringLiteral(" join ") + tableName
+                + QStringLiteral(" on ") + tableName + QStringLiteral(".rowid = ") + ftsTable + QStringLiteral(".rowid where ")
+                + ftsTable + QStringLiteral(" match ?");
+        bindValues->append(match);
+    } else {
+        if (text.trimmed().isEmpty())
+            return QString();
+        // the '%' and '_' typed by the user are searched as text, not as LIKE wildcards
+        QString pattern(text.trimmed());
+        pattern.replace(QLatin1Char('\\'), QStringLiteral("\\\\")).replace(QLatin1Char('%'), QStringLiteral("\\%")).replace(QLatin1Char('_'), QStringLiteral("\\_"));
+        QStringList likes;
+        foreach (const QString &column, index.columns) {
+            likes << column + QStringLiteral(" like ? escape '\\'");
+            bindValues->append(QVariant(QStringLiteral("%") + pattern + QStringLiteral("%")));
+        }
+        query = QStringLiteral("select *, '' as snippet, 0 as rank from ") + tableName + QStringLiteral(" where (") + likes.join(QStringLiteral(" or ")) + QStringLiteral(")");
+    }
+
+    // the 'where' filter the matched rows with equality, like the select(...) where
+    QString expression;
+    foreach (const QString &key, where.keys()) {
+        expression = columnExpression(tableName, key);
+        if (expression.isEmpty())
+            continue;
+        // in the join with the FTS5 table, the searchable columns exists in both tables
+        if (index.isFts && !key.contains(QLatin1Char('.')))
+            expression = tableName + QStringLiteral(".") + key;
+        else if (index.isFts)
+            expression.replace(QStringLiteral("json_extract("), QStringLiteral("json_extract(") + tableName + QStringLiteral("."));
+        query.append(QStringLiteral(" and ") + expression + QStringLiteral(" = ?"));
+        bindValues->append(where.value(key));
+    }
+    if (index.isFts)
+        query.append(QStringLiteral(" order by ") + tableName + QStringLiteral("_fts.rank"));
+
+    int limit = args.value(QStringLiteral("limit"), -1).toInt();
+    int offset = args.value(QStringLiteral("offset"), 0).toInt();
+    if (limit > 0 || offset > 0)
+        query.append(QStringLiteral(" limit ") + QString::number(limit));
+    if (offset > 0)
+        query.append(QStringLiteral(" offset ") + QString::number(offset));
+    return query;
+}
+
+QString Database::searchMatchString(const QString &text)
+{
+    QString term;
+    QStringList terms;
+    foreach (const QString &word, text.split(QRegExp(QStringLiteral("\\s+")), QString::SkipEmptyParts)) {
+        // inside double quotes the words are strings, never FTS5 operators like AND, OR, NEAR or column filters
+        term = QString(word).remove(QLatin1Char('"'));
+        if (!term.isEmpty())
+            terms << QStringLiteral("\"") + term + QStringLiteral("\"*");
+    }
+    return terms.join(QLatin1Char(' '));
+}
+
+bool Database::createSearchIndex(const QString &tableName, const QStringList &columns)
+{
+    QStringList searchColumns(identifiers(columns));
+    if (identifiers(tableName).size() != 1 || searchColumns.isEmpty() || searchColumns.size() != columns.size()) {
+        emit logMessage(QStringLiteral("Fatal error on try create search index: Invalid table or columns names for '") + tableName + QStringLiteral("'"));
+        return false;
+    }
+
+    openConnection();
+
+    QString ftsTable(tableName + QStringLiteral("_fts"));
+    QStringList triggers({ftsTable + QStringLiteral("_insert"), ftsTable + QStringLiteral("_delete"), ftsTable + QStringLiteral("_update")});
+
+    // the index is recreated only if the columns was changed or the triggers was dropped with the table (by some migration)
+    SearchIndex index(searchIndex(tableName));
+    if (index.isFts && index.columns == searchColumns) {
+        QSqlQuery *sqlQuery = defaultQuery();
+        sqlQuery->prepare(QStringLiteral("SELECT count(*) FROM sqlite_master WHERE type = 'trigger' AND name IN (?, ?, ?)"));
+        for (int i = 0; i < triggers.size(); ++i)
+            sqlQuery->bindValue(i, triggers.at(i));
+        bool isUpToDate = execStatement(sqlQuery) && sqlQuery->next() && sqlQuery->value(0).toInt() == triggers.size();
+        sqlQuery->finish();
+        if (isUpToDate)
+            return true;
+    }
+
+    QString fields(searchColumns.join(QStringLiteral(", ")));
+    QString newValues(QStringLiteral("new.") + searchColumns.join(QStringLiteral(", new.")));
+    QString oldValues(QStringLiteral("old.") + searchColumns.join(QStringLiteral(", old.")));
+    QString insertNew(QStringLiteral("INSERT INTO ") + ftsTable + QStringLiteral("(rowid, ") + fields + QStringLiteral(") VALUES (new.rowid, ") + newValues + QStringLiteral(");"));
+    QString deleteOld(QStringLiteral("INSERT INTO ") + ftsTable + QStringLiteral("(") + ftsTable + QStringLiteral(", rowid, ") + fields + QStringLiteral(") VALUES ('delete', old.rowid, ") + oldValues + QStringLiteral(");"));
+
+    if (!queryExec(QStringLiteral("BEGIN IMMEDIATE TRANSACTION"))) {
+        emit logMessage(QStringLiteral("Fatal error on try begin search index transaction: ") + lastError());
+        return false;
+    }
+
+    bool ok = queryExec(QStringLiteral("CREATE TABLE IF NOT EXISTS search_indexes (table_name TEXT PRIMARY KEY NOT NULL, columns TEXT NOT NULL, fts INTEGER NOT NULL)"));
+    foreach (const QString &trigger, triggers)
+        ok = ok && queryExec(QStringLiteral("DROP TRIGGER IF EXISTS ") + trigger);
+    ok = ok && queryExec(QStringLiteral("DROP TABLE IF EXISTS ") + ftsTable);
+
+    // a external content table: the text is not duplicated, only the index is saved. The prefix
+    // indexes answer the "word"* terms (see searchMatchString) without scan all terms of the index
+    bool isFts = ok && queryExec(QStringLiteral("CREATE VIRTUAL TABLE ") + ftsTable + QStringLiteral(" USING fts5(") + fields
+                                 + QStringLiteral(", content='") + tableName + QStringLiteral("', content_rowid='rowid', prefix='2 3')"));
+    if (ok && isFts) {
+        ok = queryExec(QStringLiteral("CREATE TRIGGER ") + triggers.at(0) + QStringLiteral(" AFTER INSERT ON ") + tableName + QStringLiteral(" BEGIN ") + insertNew + QStringLiteral(" END"))
+                && queryExec(QStringLiteral("CREATE TRIGGER ") + triggers.at(1) + QStringLiteral(" AFTER DELETE ON ") + tableName + QStringLiteral(" BEGIN ") + deleteOld + QStringLiteral(" END"))
+                && queryExec(QStringLiteral("CREATE TRIGGER ") + triggers.at(2) + QStringLiteral(" AFTER UPDATE OF ") + fields + QStringLiteral(" ON ") + tableName + QStringLiteral(" BEGIN ") + deleteOld + QStringLiteral(" ") + insertNew + QStringLiteral(" END"))
+                && queryExec(QStringLiteral("INSERT INTO ") + ftsTable + QStringLiteral("(") + ftsTable + QStringLiteral(") VALUES ('rebuild')"));
+    } else if (ok) {
+        emit logMessage(QStringLiteral("The sqlite FTS5 extension is not available, the search in '") + tableName + QStringLiteral("' uses LIKE!"));
+    }
+
+    if (ok) {
+        QSqlQuery *sqlQuery = defaultQuery();
+        sqlQuery->prepare(QStringLiteral("INSERT OR REPLACE INTO search_indexes (table_name, columns, fts) VALUES (?, ?, ?)"));
+        sqlQuery->bindValue(0, tableName);
+        sqlQuery->bindValue(1, searchColumns.join(QStringLiteral(",")));
+        sqlQuery->bindValue(2, isFts ? 1 : 0);
+        ok = execStatement(sqlQuery) && queryExec(QStringLiteral("COMMIT"));
+    }
+    if (!ok) {
+        emit logMessage(QStringLiteral("Fatal error on try create search index for '") + tableName + QStringLiteral("': ") + lastError());
+        queryExec(QStringLiteral("ROLLBACK"));
+        return false;
+    }
+
+    index.columns = searchColumns;
+    index.isFts = isFts;
+    QMutexLocker locker(&m_searchMutex);
+    m_searchIndexes.insert(tableName, index);
+    return true;
+}
+
+QStringList Database::searchColumns(const QString &tableName)
+{
+    return searchIndex(tableName).columns;
+}
+
+QVariantMap Database::syncState(const QString &tableName)
+{
+    openConnection();
+
+    QVariantMap state;
+    QString cacheKey(QStringLiteral("sync_state"));
+    QSqlQuery *sqlQuery = cachedStatement(cacheKey);
+    if (!sqlQuery)
+        sqlQuery = prepareStatement(cacheKey, QStringLiteral("SELECT watermark, last_id, synced_at FROM sync_state WHERE table_name = ?"));
+
+    // if the metadata table does not exists, the table was never synchronized
+    sqlQuery->bindValue(0, tableName);
+    if (sqlQuery->exec() && sqlQuery->next()) {
+        state.insert(QStringLiteral("watermark"), sqlQuery->value(0).toString());
+        state.insert(QStringLiteral("lastId"), sqlQuery->value(1).toString());
+        state.insert(QStringLiteral("syncedAt"), sqlQuery->value(2).toLongLong());
+    }
+    sqlQuery->finish();
+    return state;
+}
+
+bool Database::setSyncState(const QString &tableName, const QVariant &watermark, const QVariant &lastId)
+{
+    if (tableName.isEmpty())
+        return false;
+
+    openConnection();
+    if (!queryExec(QStringLiteral("CREATE TABLE IF NOT EXISTS sync_state (table_name TEXT PRIMARY KEY NOT NULL, watermark TEXT, last_id TEXT, synced_at INTEGER)")))
+        return false;
+
+    QSqlQuery *sqlQuery = defaultQuery();
+    if (watermark.isNull()) {
+        sqlQuery->prepare(QStringLiteral("DELETE FROM sync_state WHERE table_name = ?"));
+        sqlQuery->bindValue(0, tableName);
+    } else {
+        sqlQuery->prepare(QStringLiteral("INSERT OR REPLACE INTO sync_state (table_name, watermark, last_id, synced_at) VALUES (?, ?, ?, ?)"));
+        sqlQuery->bindValue(0, tableName);
+        sqlQuery->bindValue(1, watermark.toString());
+        sqlQuery->bindValue(2, lastId.toString());
+        sqlQuery->bindValue(3, QDateTime::currentMSecsSinceEpoch());
+    }
+    if (execStatement(sqlQuery))
+        return true;
+    emit logMessage(QStringLiteral("Fatal error on try save the sync state of '") + tableName + QStringLiteral("': ") + lastError());
+    return false;
+}
+
+Database::SearchIndex Database::searchIndex(const QString &tableName)
+{
+    QMutexLocker locker(&m_searchMutex);
+    if (m_searchIndexes.contains(tableName))
+        return m_searchIndexes.value(tableName);
+    locker.unlock();
+
+    SearchIndex index;
+    index.isFts = false;
+
+    QString cacheKey(QStringLiteral("search_index"));
+    QSqlQuery *sqlQuery = cachedStatement(cacheKey);
+    if (!sqlQuery)
+        sqlQuery = prepareStatement(cacheKey, QStringLiteral("SELECT columns, fts FROM search_indexes WHERE table_name = ?"));
+
+    // if the metadata table does not exists, no search index was created yet
+    sqlQuery->bindValue(0, tableName);
+    if (sqlQuery->exec() && sqlQuery->next()) {
+        index.columns = sqlQuery->value(0).toString().split(QLatin1Char(','), QString::SkipEmptyParts);
+        index.isFts = sqlQuery->value(1).toInt() == 1;
+    }
+    sqlQuery->finish();
+
+    locker.relock();
+    m_searchIndexes.insert(tableName, index);
+    return index;
+}
+
+bool Database::transaction(bool immediate)
+{
+    openConnection();
+    ConnectionPool::Connection *connection = m_connectionPool->connection();
+    // the IMMEDIATE transaction takes the write lock in the BEGIN, waiting the busy_timeout, so a read before
+    // the first write does not take a WAL snapshot that fails with SQLITE_BUSY_SNAPSHOT when the lock is upgraded
+    if (immediate ? !queryExec(QStringLiteral("BEGIN IMMEDIATE TRANSACTION")) : !QSqlDatabase::database(connection->name).transaction())
+        return false;
+    connection->inTransaction = true;
+    return true;
+}
+
+bool Database::commit()
+{
+    ConnectionPool::Connection *connection = m_connectionPool->connection();
+    if (!QSqlDatabase::database(connection->name).commit())
+        return false;
+
+    // publish the changes made in the transaction, one change set for each table.
+    // The result sets cached by other connections while the transaction was running are removed too
+    connection->inTransaction = false;
+    QHash<QString, QVariantList> changes;
+    changes.swap(connection->changes);
+    QHash<QString, QVariantList>::const_iterator i = changes.constBegin();
+    for (; i != changes.constEnd(); ++i) {
+        m_resultCache->invalidate(i.key());
+        emit tableChanged(i.key(), coalesceChanges(i.value()));
+    }
+    return true;
+}
+
+bool Database::rollback()
+{
+    ConnectionPool::Connection *connection = m_connectionPool->connection();
+    connection->inTransaction = false;
+    // the result sets cached in the transaction can have the discarded changes
+    foreach (const QString &tableName, connection->changes.keys())
+        m_resultCache->invalidate(tableName);
+    connection->changes.clear();
+    return QSqlDatabase::database(connection->name).rollback();
+}
+
+void Database::trackChange(const QString &tableName, const QString &operation, const QVariantMap &data, const QVariantMap &where, const QVariantList &rowIds)
+{
+    m_resultCache->invalidate(tableName);
+
+    // one change for each changed row. Without the rowids (like the WITHOUT ROWID tables), a single change with the filter
+    QVariantMap change;
+    change.insert(QStringLiteral("op"), operation);
+    if (!data.isEmpty())
+        change.insert(QStringLiteral("data"), data);
+    if (!where.isEmpty())
+        change.insert(QStringLiteral("where"), where);
+
+    QVariantList changes;
+    if (rowIds.isEmpty()) {
+        changes << change;
+    } else {
+        changes.reserve(rowIds.size());
+        foreach (const QVariant &rowId, rowIds) {
+            change.insert(QStringLiteral("rowid"), rowId);
+            changes << change;
+        }
+    }
+
+    // without transaction, the changes are published now. In a transaction, are coalesced in the commit
+    ConnectionPool::Connection *connection = m_connectionPool->connection();
+    if (!connection->inTransaction)
+        emit tableChanged(tableName, changes);
+    else
+        connection->changes[tableName] << changes;
+}
+
+QVariantList Database::coalesceChanges(const QVariantList &changes)
+{
+    // the last change of each rowid is merged with the first change of the same rowid:
+    // a inserted and removed row is not published, a inserted and updated row is published as inserted
+    // with the new data, the updates are merged in one update and a updated and removed row is published as removed
+    qint64 rowId = 0;
+    int index = 0;
+    QVariantMap change;
+    QVariantMap previous;
+    QVariantMap mergedData;
+    QString operation;
+    QString previousOperation;
+    QVariantList coalesced;
+    QHash<qint64, int> indexes;
+    coalesced.reserve(changes.size());
+
+    foreach (const QVariant &item, changes) {
+        change = item.toMap();
+        if (!change.contains(QStringLiteral("rowid"))) {
+            coalesced << change;
+            continue;
+        }
+        rowId = change.value(QStringLiteral("rowid")).toLongLong();
+        index = indexes.value(rowId, -1);
+        operation = change.value(QStringLiteral("op")).toString();
+        previousOperation = index < 0 ? QString() : coalesced.at(index).toMap().value(QStringLiteral("op")).toString();
+
+        // the first change of the row, or a rowid reused by a insert after the remove
+        if (index < 0 || previousOperation == QStringLiteral("remove") || operation == QStringLiteral("insert")) {
+            indexes.insert(rowId, coalesced.size());
+            coalesced << change;
+            continue;
+        }
+
+        previous = coalesced.at(index).toMap();
+        if (operation == QStringLiteral("remove")) {
+            // the inserted and removed row never existed for the listeners
+            coalesced[index] = previousOperation == QStringLiteral("insert") ? QVariant() : QVariant(change);
+            if (previousOperation == QStringLiteral("insert"))
+                indexes.remove(rowId);
+            continue;
+        }
+
+        mergedData = previous.value(QStringLiteral("data")).toMap();
+        foreach (const QString &key, change.value(QStringLiteral("data")).toMap().keys())
+            mergedData.insert(key, change.value(QStringLiteral("data")).toMap().value(key));
+        if (previousOperation != QStringLiteral("insert"))
+            previous.insert(QStringLiteral("op"), operation);
+        previous.insert(QStringLiteral("data"), mergedData);
+        coalesced[index] = previous;
+    }
+
+    // the dropped changes are invalid values
+    coalesced.removeAll(QVariant());
+    return coalesced;
+}
+
+QVariantList Database::changedRowIds(const QString &tableName, const QString &whereStr, const QVariantList &values)
+{
+    QVariantList rowIds;
+    QString query(QStringLiteral("SELECT rowid FROM ") + tableName + QStringLiteral(" WHERE ") + whereStr);
+    QSqlQuery *sqlQuery = cachedStatement(query);
+    if (!sqlQuery)
+        sqlQuery = prepareStatement(query, query);
+
+    int k = 0;
+    foreach (const QVariant &value, values)
+        sqlQuery->bindValue(k++, value);
+
+    // the WITHOUT ROWID tables does not have the rowid column
+    if (!execStatement(sqlQuery))
+        return rowIds;
+    while (sqlQuery->next())
+        rowIds << sqlQuery->value(0);
+    sqlQuery->finish();
+    return rowIds;
+}
+
+QVariantList Database::upsertedRowId(const QString &tableName, const QVariantMap &data, const QStringList &conflictColumns)
+{
+    // the updated row does not change the last insert id, so the row is found by the conflict columns
+    QString whereStr;
+    QVariantList values;
+    foreach (const QString &column, conflictColumns) {
+        if (!data.contains(column))
+            return QVariantList();
+        if (!whereStr.isEmpty())
+            whereStr += QStringLiteral(" AND ");
+        whereStr += column + QStringLiteral(" = ?");
+        values << data.value(column);
+    }
+    return changedRowIds(tableName, whereStr, values);
+}
+
+int Database::remove(const QString &tableName, const QVariantMap &where, const QString &whereComparator)
+{
+    QVariantMap args;
+    args.insert(QStringLiteral("whereComparator"), whereComparator);
+    return removeWhere(tableName, where, args);
+}
+
+int Database::removeWhere(const QString &tableName, const QVariantMap &where, const QVariantMap &args)
+{
+    if (tableName.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try remove item: The table name is empty!"));
+        return 0;
+    } else if (where.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try remove item: The where parameter is empty!"));
+        return 0;
+    }
+
+    // the operators are put in the query string, so only the known operators are accepted
+    static const QStringList comparators({QStringLiteral("="), QStringLiteral("!="), QStringLiteral("<>"), QStringLiteral("<"),
+                                          QStringLiteral(">"), QStringLiteral("<="), QStringLiteral(">="), QStringLiteral("LIKE")});
+    QString whereOperator(args.value(QStringLiteral("whereOperator"), QStringLiteral("AND")).toString().toUpper());
+    QString whereComparator(args.value(QStringLiteral("whereComparator"), QStringLiteral("=")).toString().toUpper());
+    if ((whereOperator != QStringLiteral("AND") && whereOperator != QStringLiteral("OR")) || !comparators.contains(whereComparator)) {
+        emit logMessage(QStringLiteral("Fatal error on try remove item: invalid where operator '") + whereOperator + QStringLiteral("' or comparator '") + whereComparator + QStringLiteral("'"));
+        return 0;
+    }
+    bool isNegation = whereComparator == QStringLiteral("!=") || whereComparator == QStringLiteral("<>");
+
+    int k = 0;
+    QString whereStr;
+    QString expression;
+    QStringList placeholders;
+    QVariantList values;
+    QMap<QString, QVariant>::const_iterator i = where.constBegin();
+    for (; i != where.constEnd(); ++i) {
+        expression = columnExpression(tableName, i.key());
+        if (expression.isEmpty())
+            return 0;
+        if (k++ > 0)
+            whereStr += QStringLiteral(" ") + whereOperator + QStringLiteral(" ");
+
+        // a list value is compared with IN, like {"id": [1, 2, 3]}
+        if (i.value().userType() == QMetaType::QVariantList) {
+            const QVariantList list(i.value().toList());
+            placeholders.clear();
+            for (int j = 0; j < list.size(); ++j)
+                placeholders << QStringLiteral("?");
+            whereStr += expression + (isNegation ? QStringLiteral(" NOT IN (") : QStringLiteral(" IN (")) + placeholders.join(QStringLiteral(", ")) + QStringLiteral(")");
+            values << list;
+        } else {
+            whereStr += expression + QStringLiteral(" ") + whereComparator + QStringLiteral(" ?");
             values << i.value();
-            ++i;
         }
     }
 
     openConnection();
 
-    m_qsqlQuery.prepare(QStringLiteral("UPDATE ") + tableName + QStringLiteral(" SET ") + updateValues + QStringLiteral(" WHERE ") + whereStr + QStringLiteral(";"));
+    // the rows are read before removed, to publish the removed rowids
+    QVariantList rowIds(changedRowIds(tableName, whereStr, values));
+
+    // the generated query is the statement cache key, like in selectCursor
+    QString query(QStringLiteral("DELETE FROM ") + tableName + QStringLiteral(" WHERE ") + whereStr);
+    QSqlQuery *sqlQuery = cachedStatement(query);
+    if (!sqlQuery)
+        sqlQuery = prepareStatement(query, query);
+
+    k = 0;
+    foreach (const QVariant &value, values)
+        sqlQuery->bindValue(k++, value);
+
+    if (!execStatement(sqlQuery)) {
+        emit logMessage(QStringLiteral("Fatal error on try remove: ") + sqlQuery->lastError().text());
+        return 0;
+    }
+
+    int removed = sqlQuery->numRowsAffected();
+    if (removed > 0)
+        trackChange(tableName, QStringLiteral("remove"), QVariantMap(), where, rowIds);
+    return removed;
+}
+
+QVariantMap Database::removeIds(const QString &tableName, const QVariantList &ids, const QString &pkColumn)
+{
+    // the chunk is smaller than the max number of bound values of the old sqlite versions (999)
+    static const int chunkSize = 500;
+
+    int total = ids.size();
+    QVariantMap result;
+    result.insert(QStringLiteral("removed"), 0);
+    result.insert(QStringLiteral("failed"), total);
+
+    QRegExp identifier(QStringLiteral("[A-Za-z_][A-Za-z0-9_]*"));
+    if (tableName.isEmpty() || !identifier.exactMatch(pkColumn)) {
+        emit logMessage(QStringLiteral("Fatal error on try remove ids: The table name is empty or the primary key column is invalid!"));
+        return result;
+    } else if (!total) {
+        result.insert(QStringLiteral("failed"), 0);
+        return result;
+    }
+
+    // inside a transaction of the caller, the chunks are part of the caller transaction
+    openConnection();
+    bool isOwnTransaction = !m_connectionPool->connection()->inTransaction;
+    if (isOwnTransaction && !transaction(true)) {
+        emit logMessage(QStringLiteral("Fatal error on try remove ids: ") + lastError());
+        return result;
+    }
+
+    int k = 0;
+    int removed = 0;
+    bool ok = true;
+    QString cacheKey;
+    QStringList placeholders;
+    QString whereStr;
+    QVariantList chunk;
+    QVariantList rowIds;
+    QVariantMap where;
+    QSqlQuery *sqlQuery = nullptr;
+
+    for (int i = 0; ok && i < total; i += chunkSize) {
+        chunk = ids.mid(i, chunkSize);
+        placeholders.clear();
+        for (k = 0; k < chunk.size(); ++k)
+            placeholders << QStringLiteral("?");
+        whereStr = pkColumn + QStringLiteral(" IN (") + placeholders.join(QStringLiteral(", ")) + QStringLiteral(")");
+        rowIds = changedRowIds(tableName, whereStr, chunk);
+
+        // all full chunks reuse the same prepared statement
+        cacheKey = QStringLiteral("remove_ids:") + tableName + QStringLiteral(":") + pkColumn + QStringLiteral(":") + QString::number(chunk.size());
+        sqlQuery = cachedStatement(cacheKey);
+        if (!sqlQuery)
+            sqlQuery = prepareStatement(cacheKey, QStringLiteral("DELETE FROM ") + tableName + QStringLiteral(" WHERE ") + whereStr);
+
+        k = 0;
+        foreach (const QVariant &id, chunk)
+            sqlQuery->bindValue(k++, id);
+
+        ok = execStatement(sqlQuery);
+        if (ok && sqlQuery->numRowsAffected() > 0) {
+            removed += sqlQuery->numRowsAffected();
+            where.insert(pkColumn, chunk);
+            trackChange(tableName, QStringLiteral("remove"), QVariantMap(), where, rowIds);
+        }
+    }
+
+    if (!ok) {
+        emit logMessage(QStringLiteral("Fatal error on try remove ids: ") + sqlQuery->lastError().text());
+        if (isOwnTransaction)
+            rollback();
+        return result;
+    }
+
+    if (isOwnTransaction && !commit()) {
+        emit logMessage(QStringLiteral("Fatal error on try commit remove ids: ") + lastError());
+        rollback();
+        return result;
+    }
+
+    emit logMessage(QString(QStringLiteral("Remove ids in '%1': %2 rows removed of %3 ids")).arg(tableName).arg(removed).arg(total));
+    result.insert(QStringLiteral("removed"), removed);
+    result.insert(QStringLiteral("failed"), 0);
+    return result;
+}
+
+int Database::update(const QString &tableName, const QVariantMap &updateData, const QVariantMap &where, const QVariantMap &args)
+{
+    if (tableName.isEmpty()) {
+        emit logMessage(QStringLiteral("Fatal error on try update: The table name is empty!"));
+        return 0;
+    } else if (where.empty()) {
+        emit logMessage(QStringLiteral("Fatal error on try update: The WHERE parameter must be set to update operation!"));
+        return 0;
+    }
+
+    QVariantList values(updateData.values());
+    values << where.values();
+
+    const QString &whereOperator(args.value(QStringLiteral("whereOperator"), QStringLiteral("AND")).toString());
+    const QString &whereComparator(args.value(QStringLiteral("whereComparator"), QStringLiteral("=")).toString());
+
+    openConnection();
+
+    int k = 0;
+    QString whereStr;
+    QString separator;
+    QMap<QString, QVariant>::const_iterator i = where.constBegin();
+    while (i != where.constEnd()) {
+        separator = (k++ == 0) ? QStringLiteral("") : (QStringLiteral(" ") + whereOperator + QStringLiteral(" "));
+        whereStr += QString("%1%2 %3 ?").arg(separator, columnExpression(tableName, i.key()), whereComparator);
+        ++i;
+    }
+
+    // the rows are read before updated (the update can change the filtered columns), to publish the updated rowids
+    QVariantList rowIds(changedRowIds(tableName, whereStr, where.values()));
+
+    // the update query is build and prepared only if is not in the statements cache
+    QString cacheKey(QStringLiteral("update:") + tableName + QStringLiteral(":") + QStringList(updateData.keys()).join(QStringLiteral(","))
+                     + QStringLiteral(":") + whereOperator + QStringLiteral(":") + whereComparator + QStringLiteral(":") + QStringList(where.keys()).join(QStringLiteral(",")));
+    QSqlQuery *sqlQuery = cachedStatement(cacheKey);
+    if (!sqlQuery) {
+        k = 0;
+        QString updateValues;
+        i = updateData.constBegin();
+        while (i != updateData.constEnd()) {
+            separator = (k++ == 0) ? QStringLiteral("") : QStringLiteral(",");
+            updateValues.append(QString("%1%2=?").arg(separator, i.key()));
+            ++i;
+        }
+        sqlQuery = prepareStatement(cacheKey, QStringLiteral("UPDATE ") + tableName + QStringLiteral(" SET ") + updateValues + QStringLiteral(" WHERE ") + whereStr + QStringLiteral(";"));
+    }
 
+    k = 0;
     foreach (const QVariant &value, values)
-        m_qsqlQuery.addBindValue(value);
+        sqlQuery->bindValue(k++, value);
 
-    if (m_qsqlQuery.exec())
-        return numRowsAffected();
+    if (execStatement(sqlQuery)) {
+        int updated = sqlQuery->numRowsAffected();
+        if (updated > 0)
+            trackChange(tableName, QStringLiteral("update"), updateData, where, rowIds);
+        return updated;
+    }
 
     QString error(lastError());
     if (!error.isEmpty()) {
@@ -365,9 +2220,57 @@ int Database::update(const QString &tableName, const QVariantMap &updateData, co
     return 0;
 }
 
+bool Database::execStatement(QSqlQuery *sqlQuery, const QString &query, bool profile)
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool success = query.isEmpty() ? sqlQuery->exec() : sqlQuery->exec(query);
+    if (success && profile)
+        profileQuery(sqlQuery, timer.nsecsElapsed(), sqlQuery->isSelect() ? -1 : sqlQuery->numRowsAffected());
+    return success;
+}
+
+void Database::profileQuery(QSqlQuery *sqlQuery, qint64 elapsedNs, int rows)
+{
+    QueryProfiler *profiler = QueryProfiler::instance();
+    if (!profiler->isEnabled())
+        return;
+
+    QString query(sqlQuery->lastQuery());
+    if (!profiler->record(query, elapsedNs, rows, m_connectionPool->connection()->lastCacheHit))
+        return;
+
+    // the query is slow, so capture the query plan with the same bound values
+    QSqlQuery plan(QSqlDatabase::database(m_connectionPool->connection()->name));
+    plan.prepare(QStringLiteral("EXPLAIN QUERY PLAN ") + query);
+    int totalValues = sqlQuery->boundValues().size();
+    for (int i = 0; i < totalValues; ++i)
+        plan.bindValue(i, sqlQuery->boundValue(i));
+
+    QStringList lines;
+    if (plan.exec()) {
+        // the 'detail' column is the last column, like 'SCAN TABLE messages' or 'SEARCH TABLE messages USING INDEX ...'
+        while (plan.next())
+            lines << plan.value(plan.record().count() - 1).toString();
+    } else {
+        lines << plan.lastError().text();
+    }
+    profiler->setPlan(query, lines);
+}
+
+QVariantMap Database::profilerReport() const
+{
+    return QueryProfiler::instance()->report();
+}
+
+bool Database::dumpProfilerReport(const QString &filePath)
+{
+    return QueryProfiler::instance()->dump(filePath);
+}
+
 int Database::lastInsertId() const
 {
-    QVariant idTemp = m_qsqlQuery.lastInsertId();
+    QVariant idTemp = query()->lastInsertId();
     return idTemp.isValid() ? idTemp.toInt() : 0;
 }
 
@@ -377,23 +2280,32 @@ int Database::lastRowId(const QString &tableName)
     if (tableName.isEmpty()) {
         emit logMessage(QStringLiteral("Fatal error on lastRowId! The table name is empty!"));
     } else if (queryExec(QString("SELECT ROWID from %1 order by ROWID DESC limit 1").arg(tableName))) {
-        while (m_qsqlQuery.next())
-            rowId = m_qsqlQuery.value(0).toInt();
+        QSqlQuery *sqlQuery = query();
+        while (sqlQuery->next())
+            rowId = sqlQuery->value(0).toInt();
     }
     return rowId;
 }
 
 int Database::numRowsAffected() const
 {
-    return m_qsqlQuery.numRowsAffected();
+    return query()->numRowsAffected();
 }
 
 QString Database::lastQuery() const
 {
-    return m_qsqlQuery.lastQuery();
+    return query()->lastQuery();
 }
 
 QString Database::lastError() const
 {
-    return m_qsqlQuery.lastError().text();
+    return query()->lastError().text();
+}
+
+QVariantMap Database::statementCacheStats() const
+{
+    QVariantMap stats;
+    stats.insert(QStringLiteral("hits"), m_statementCacheHits.load());
+    stats.insert(QStringLiteral("misses"), m_statementCacheMisses.load());
+    return stats;
 }
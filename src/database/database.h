@@ -1,17 +1,26 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include <QAtomicInt>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
 #include <QObject>
-#include <QSqlDatabase>
+#include <QPointer>
 #include <QSqlQuery>
 #include <QVariant>
 
+class ConnectionPool;
+class JsonImporter;
+class ResultCache;
 class QByteArray;
 class QDir;
 class QFile;
+class QIODevice;
 class QSqlError;
 class QSqlRecord;
 class QStringList;
+class QThread;
 class QUrl;
 
 /**
@@ -19,6 +28,8 @@ class QUrl;
  * This class implements a Singleton pattern and manage database operations
  * with high level methods to select, update, insert and remove data into application database.
  * Supports only SQLITE and all operations is handle by QSqlDatabase and QSqlQuery with some customizations.
+ * Each thread that use the Database instance receive your own connection and QSqlQuery object from a ConnectionPool,
+ * so the GUI thread and the AsyncSelect or PluginDatabaseTableCreator workers can execute queries at the same time.
  */
 class Database : public QObject
 {
@@ -52,10 +63,234 @@ private:
 
     /**
      * @brief openConnection
-     * Open the first connection with database if is not yet opened.
+     * Open the connection for the current thread if is not yet opened.
      * This method too be create the ".db" file on the first object query execution.
+     * @return bool true if the current thread connection is open, otherwise false
      */
-    void openConnection();
+    bool openConnection();
+
+    /**
+     * @brief query
+     * Return the QSqlQuery object of the current thread connection.
+     * Each thread has your own query object, so the query state is never shared between threads.
+     * @return QSqlQuery*
+     */
+    QSqlQuery *query() const;
+
+    /**
+     * @brief defaultQuery
+     * Return the generic QSqlQuery object of the current thread connection, used by non cached queries,
+     * and set it as the last query of the connection.
+     * @return QSqlQuery*
+     */
+    QSqlQuery *defaultQuery();
+
+    /**
+     * @brief cachedStatement
+     * Return the prepared statement saved with 'cacheKey' in the current thread connection cache.
+     * If the statement is found, it will be set as the last query of the connection.
+     * Each call increment the statement cache hits or misses counter.
+     * @param cacheKey QString the statement key, built from table name, operation and columns set
+     * @return QSqlQuery* the prepared statement or nullptr if is not in the cache
+     */
+    QSqlQuery *cachedStatement(const QString &cacheKey);
+
+    /**
+     * @brief prepareStatement
+     * Prepare the 'sqlQueryString' in a new QSqlQuery and save in the current thread connection cache using the 'cacheKey'.
+     * If the cache is disabled or the query cannot be prepared, the default query is used (and not cached).
+     * @param cacheKey QString the statement key, built from table name, operation and columns set
+     * @param sqlQueryString QString the query to prepare
+     * @return QSqlQuery* the prepared statement, set as the last query of the connection
+     */
+    QSqlQuery *prepareStatement(const QString &cacheKey, const QString &sqlQueryString);
+
+    /**
+     * @brief insertStatement
+     * Return the prepared insert statement for 'tableName' with the 'fields' columns,
+     * from the statements cache or prepared if not in the cache. The values needs to be bind in the same order of 'fields'.
+     * @param tableName QString the table name
+     * @param fields QStringList the columns names
+     * @param ignoreConflicts bool if true, uses 'ON CONFLICT(pk) DO NOTHING', so rows with a existing primary key are skipped.
+     * The rows that fails other constraints (like NOT NULL, CHECK or a unique column) are not inserted and the error is returned.
+     * For tables without a declared primary key, the rows with a existing unique column are skipped.
+     * @return QSqlQuery*
+     */
+    QSqlQuery *insertStatement(const QString &tableName, const QStringList &fields, bool ignoreConflicts = false);
+
+    /**
+     * @brief primaryKeyColumns
+     * Return the primary key columns of 'tableName', in the key order, read from 'PRAGMA table_info'
+     * @param tableName QString the table name, or "schema.table" for the attached databases
+     * @return QStringList a empty list if the table does not declare a primary key
+     */
+    QStringList primaryKeyColumns(const QString &tableName);
+
+    /**
+     * @brief upsertStatement
+     * Return the prepared 'INSERT ... ON CONFLICT(conflictColumns) DO UPDATE' statement for 'tableName' with the 'fields' columns,
+     * from the statements cache or prepared if not in the cache. The values needs to be bind in the same order of 'fields'.
+     * The columns not in 'conflictColumns' are updated with the new values. If all fields are conflict columns, uses 'DO NOTHING'.
+     * @param tableName QString the table name
+     * @param fields QStringList the columns names
+     * @param conflictColumns QStringList the primary key or unique columns used to detect the conflict
+     * @return QSqlQuery*
+     */
+    QSqlQuery *upsertStatement(const QString &tableName, const QStringList &fields, const QStringList &conflictColumns);
+
+    /**
+     * @brief identifiers
+     * Return the valid column names from 'value' (a string, a comma separated string or a list of strings).
+     * The names are put in the query string, so only identifiers (like "price" or "products.price") are accepted.
+     * @param value QVariant
+     * @param acceptAll bool if true, accept the "*" too
+     * @return QStringList
+     */
+    QStringList identifiers(const QVariant &value, bool acceptAll = false);
+
+    /**
+     * @brief migrationFiles
+     * Return the migrations files of the plugin in 'pluginDirPath' as version -> file path, sorted by version.
+     * @param pluginDirPath QString the plugin directory absolute path
+     * @return QMap<int, QString>
+     */
+    QMap<int, QString> migrationFiles(const QString &pluginDirPath);
+
+    /**
+     * @brief readSqlFile
+     * Read the ".sql" file and append the statements to 'statements'. The transaction statements (BEGIN, COMMIT, END and ROLLBACK)
+     * are ignored, because the caller execute the statements in your own transaction.
+     * @param filePath QString the path to ".sql" file
+     * @param statements QStringList* the list to append the statements
+     * @return bool false if the file cannot be read
+     */
+    bool readSqlFile(const QString &filePath, QStringList *statements);
+
+    /**
+     * @brief execStatements
+     * Execute each statement using queryExec and stop in the first error.
+     * @param statements QStringList
+     * @return bool true if all statements was executed
+     */
+    bool execStatements(const QStringList &statements);
+
+    /**
+     * @brief hasCreatedTables
+     * Return true if all tables created by the 'CREATE TABLE' statements already exists in database.
+     * Used by migrate to save the version 1 of the installs created before the migrations, without execute plugin_table.sql again.
+     * @param statements QStringList the statements of the sql file
+     * @return bool false if some table does not exists or the statements does not create tables
+     */
+    bool hasCreatedTables(const QStringList &statements);
+
+    /**
+     * @brief saveSchemaVersion
+     * Save the 'version' as the last migration applied for 'pluginName' in the 'schema_migrations' table.
+     * @param pluginName QString the plugin name
+     * @param version int the migration version
+     * @return bool
+     */
+    bool saveSchemaVersion(const QString &pluginName, int version);
+
+    /**
+     * @brief execStatement
+     * Execute the query and, if 'profile' is true, send the execution time and the affected rows to the QueryProfiler.
+     * @param sqlQuery QSqlQuery* the prepared query
+     * @param query QString if not empty, the query is executed with exec(query). Otherwise, the prepared query is executed.
+     * @param profile bool false if the caller profile the query after read the rows
+     * @return bool the QSqlQuery::exec result
+     */
+    bool execStatement(QSqlQuery *sqlQuery, const QString &query = QString(), bool profile = true);
+
+    /**
+     * @brief trackChange
+     * Register a change for each row in 'rowIds'. Without transaction, the tableChanged signal is emitted now.
+     * In a transaction, the changes are kept until the commit and coalesced by rowid (see coalesceChanges).
+     * @param tableName QString the changed table
+     * @param operation QString "insert", "update", "upsert" or "remove"
+     * @param data QVariantMap the inserted or updated column_name -> value
+     * @param where QVariantMap the update or remove filter condition
+     * @param rowIds QVariantList the changed rowids. If empty (like in the WITHOUT ROWID tables), a single change is registered.
+     */
+    void trackChange(const QString &tableName, const QString &operation, const QVariantMap &data = QVariantMap(), const QVariantMap &where = QVariantMap(), const QVariantList &rowIds = QVariantList());
+
+    /**
+     * @brief coalesceChanges
+     * Merge the changes of the same rowid made in a transaction, keeping the position of the first change:
+     * a inserted and removed row is dropped, a inserted and updated (or upserted) row is a insert with the new data,
+     * the updates of a row are a single update with the merged data and a updated and removed row is a remove.
+     * @param changes QVariantList the changes in the execution order
+     * @return QVariantList
+     */
+    static QVariantList coalesceChanges(const QVariantList &changes);
+
+    /**
+     * @brief changedRowIds
+     * Return the rowids of 'tableName' filtered by 'whereStr', read before a update or remove to publish the changed rows.
+     * The statement is cached by the query string.
+     * @param tableName QString the table name
+     * @param whereStr QString the where clause, with placeholders
+     * @param values QVariantList the values to bind in the placeholders
+     * @return QVariantList a empty list if the table does not have rowid
+     */
+    QVariantList changedRowIds(const QString &tableName, const QString &whereStr, const QVariantList &values);
+
+    /**
+     * @brief upsertedRowId
+     * Return the rowid of the upserted row, found by the 'conflictColumns' values in 'data'
+     * @param tableName QString the table name
+     * @param data QVariantMap the upserted row
+     * @param conflictColumns QStringList the conflict columns of the upsert
+     * @return QVariantList a list with the rowid, or a empty list if not found
+     */
+    QVariantList upsertedRowId(const QString &tableName, const QVariantMap &data, const QStringList &conflictColumns);
+
+    /**
+     * @brief selectQueryString
+     * Build the SQL select query used by selectCursor, from 'where' and 'args' (see the select(...) arguments).
+     * The values to bind in the query placeholders are appended to 'bindValues', in the placeholders order.
+     * @param tableName QString the name of the table
+     * @param where QVariantMap a map with column name and column value to build the query predicates
+     * @param args QVariantMap a map with the query extra arguments
+     * @param bindValues QVariantList* the list to append the values to bind
+     * @return QString the select query
+     */
+    QString selectQueryString(const QString &tableName, const QVariantMap &where, const QVariantMap &args, QVariantList *bindValues);
+
+    /**
+     * @brief columnExpression
+     * Return the SQL expression for a column name used in select queries. The column names and the columns qualified
+     * by the table name are returned without changes. The json paths, like "profile.address.city" or "tags.0", are
+     * returned as json_extract(profile, '$.address.city') and json_extract(tags, '$[0]').
+     * The json paths of the CBOR columns (see setCborColumns) are logged and ignored.
+     * @param tableName QString the table name
+     * @param key QString the column name or json path
+     * @return QString the expression or a empty string if the json path is invalid or the column is CBOR
+     */
+    QString columnExpression(const QString &tableName, const QString &key);
+
+    /**
+     * @brief searchQueryString
+     * Build the SQL query used by searchCursor. With a FTS5 index, the query is a MATCH in the '<tableName>_fts' table
+     * joined with 'tableName' by rowid and ordered by rank. Without FTS5, the query is a LIKE in each searchable column,
+     * with the '%' and '_' of the text escaped. The 'where' columns are compared with '=' and combined with AND.
+     * @param tableName QString the name of the table
+     * @param text QString the text typed by the user
+     * @param where QVariantMap the column_name -> value used to filter the matched rows
+     * @param args QVariantMap the "limit" and "offset" arguments
+     * @param bindValues QVariantList* the list to append the values to bind
+     * @return QString the search query, or a empty string if the table has no search index or the text has no terms
+     */
+    QString searchQueryString(const QString &tableName, const QString &text, const QVariantMap &where, const QVariantMap &args, QVariantList *bindValues);
+
+    /**
+     * @brief searchMatchString
+     * Convert the text typed by the user to a FTS5 query, where each word is a quoted prefix term: 'mou log' -> '"mou"* "log"*'.
+     * The FTS5 operators and the double quotes typed by the user are not interpreted.
+     * @param text QString
+     * @return QString
+     */
+    static QString searchMatchString(const QString &text);
 
     /**
      * @brief setFileName
@@ -64,6 +299,25 @@ private:
      */
     void setFileName();
 
+    /**
+     * @brief loadSettings
+     * Load the "database" object from config.json and set the pragmas applied once in each connection.
+     * The follow options can be set (the default values are used if not set):
+     * "journal_mode"    -> QString default is "WAL", so readers never block the writers
+     * "synchronous"     -> QString default is "NORMAL", with WAL only the checkpoints fsync
+     * "cache_size"      -> integer default is -8000 (8MB of page cache)
+     * "mmap_size"       -> integer default is 33554432 (32MB of memory mapped I/O)
+     * "temp_store"      -> QString default is "MEMORY"
+     * "busy_timeout"    -> integer default is 5000 milliseconds to wait for a locked database
+     * "auto_vacuum"     -> QString default is "INCREMENTAL", so DatabaseMaintenance can free the pages of the removed rows.
+     *                      Only applied when the .db file is created.
+     * "max_connections" -> integer the max number of connections of the QueryExecutor workers. Default is the QueryExecutor thread count.
+     *                      The GUI thread and the dedicated threads (see addDedicatedThread) are not counted
+     * "statement_cache_size" -> integer the max number of prepared statements cached by each connection. Default is 64
+     * "result_cache_size" -> integer the max memory in bytes used by the select result sets cache. Default is 4194304 (4MB), zero disable
+     */
+    void loadSettings();
+
 public:
     /**
      * @brief The SELECT_TYPE enum
@@ -92,6 +346,35 @@ public:
      */
     bool queryExec(const QString &sqlQueryString);
 
+    /**
+     * @brief attachSeedDatabase
+     * Attach the sqlite file 'filePath' as a read-only schema named 'alias' in all connections, so a plugin can ship
+     * static data (like a city list) as a prebuilt database instead of insert the rows on the first run.
+     * The tables are used with the schema prefix, like select("catalog.products") or the DatabaseComponent tableName "catalog.products".
+     * The files from android assets or qt resources are copied once to the application directory, because sqlite reads only the file system.
+     * Called by PluginManager for the 'seed.db' file of each plugin.
+     * @param alias QString the schema name, a identifier different of "main" and "temp"
+     * @param filePath QString the sqlite file path
+     * @return bool false if the alias is invalid or the file does not exists
+     */
+    Q_INVOKABLE bool attachSeedDatabase(const QString &alias, const QString &filePath);
+
+    /**
+     * @brief fileName
+     * Return the absolute path of the sqlite .db file
+     * @return QString
+     */
+    QString fileName() const;
+
+    /**
+     * @brief addDedicatedThread
+     * Exclude the connection of 'thread' from the "max_connections" limit (see ConnectionPool::addDedicatedThread).
+     * Called by the long running threads (WriteQueue, PluginDatabaseTableCreator, JsonImporter and DatabaseMaintenance),
+     * so they never wait for the QueryExecutor workers release a connection.
+     * @param thread QThread*
+     */
+    void addDedicatedThread(QThread *thread);
+
     /**
      * @brief tableColumns
      * Return a list of table columns names as QStringList
@@ -128,36 +411,438 @@ public:
      * "limit"   -> integer with the SQL LIMIT of result set
      * "offset"  -> integer with the SQL OFFSET to start the result set list (useful to paginate data)
      * "order"   -> QString with the SQL "asc" or "desc" value to define the result set as descending or not
-     * "orderBy" -> QString the column name to ordenate the result set
+     * "orderBy" -> QString the columns (or json paths) to ordenate the result set, separated by comma and optionally followed by "asc" or "desc".
+     *              The invalid terms are ignored.
      * "whereOperator" -> QString the with "AND" or "OR" to set the predicates clauses comparison operator for 'where' map arguments
      * "whereComparator" -> QString with the value: "=" or "!=" or ">" or  "<" or "%LIKE%" and is used to set the predicates comparator value operator
      * "selectType" -> integer with value to construct the result set map. If the table uses "meta_key" -> "meta_value" columns.
      * in this case, set the "selectType" to 1 to get each map as table key and table value properties.
+     * "after"   -> QString a page token (see selectPage) to select the rows after the token, using keyset pagination.
+     * "before"  -> QString a page token (see selectPage) to select the rows before the token, using keyset pagination.
+     * "pkColumn" -> QString the primary key column used by keyset pagination. Default is "id".
+     * "columns" -> QStringList (or a comma separated string) the columns to select. Default is all columns (*).
+     * "count"   -> QString "*" or a column name, selected as "count" (for "*") or "count_column".
+     * "sum", "avg", "min", "max" -> QStringList (or a string) the columns to aggregate, selected as "sum_column", "avg_column"...
+     * "groupBy" -> QStringList (or a comma separated string) the columns to group the rows. The columns are selected too.
+     * The 'where' keys, "columns", "groupBy" and aggregates accept json paths, like "profile.city" or "tags.0", compiled to
+     * json_extract(profile, '$.city'). The json paths are selected as "profile_city", and only the selected value is read
+     * from the json document. To not scan the table, create a index for the filtered paths (see createJsonIndex).
+     * Example: select("products", {}, {"groupBy": "category", "count": "*", "max": "price"}) return
+     * the maps with "category", "count" and "max_price" for each category.
+     * When "after" or "before" is set, "offset" and "orderby" are ignored and the rows are ordered by "pkColumn" using "order".
+     * The query is built as 'WHERE pk > ? ORDER BY pk LIMIT n', so the cost is the same for any page.
+     * The result set is saved in the ResultCache and the same selection is returned from memory until the table is changed.
      *
      * @return QVariantList of QVariantMap with column_name -> value
      */
     Q_INVOKABLE QVariantList select(const QString &tableName, const QVariantMap &where = QVariantMap(), const QVariantMap &args = QVariantMap());
 
+    /**
+     * @brief selectCursor
+     * Execute the same SQL select query of select(...) method, but instead of load all the result set,
+     * return the executed statement positioned before the first row, to be iterated by the caller with QSqlQuery::next().
+     * This is useful to read large result sets in parts, like in AsyncSelect.
+     *
+     * @WARNING!
+     * The statement belongs to the current thread connection and needs to be used only in this thread.
+     * The caller needs to call QSqlQuery::finish() after read the rows and can not execute other queries while iterate.
+     * @param tableName QString the name of the table to execute the query
+     * @param where QVariantMap a map with column name and column value to build the query predicates.
+     * @param args QVariantMap the same arguments accepted by select(...)
+     * @return QSqlQuery* the executed statement or nullptr if the query cannot be executed
+     */
+    QSqlQuery *selectCursor(const QString &tableName, const QVariantMap &where = QVariantMap(), const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief selectPage
+     * Select a page of rows using keyset pagination, with the same arguments of select(...).
+     * To load the first page, do not set "after" or "before" in args. To load the next page, set the returned
+     * "next" token as "after" argument. To load the previous page, set the "previous" token as "before" argument.
+     * @param tableName QString the name of the table to execute the query
+     * @param where QVariantMap a map with column name and column value to build the query predicates.
+     * @param args QVariantMap the select(...) arguments, with "limit" as page size
+     * @return QVariantMap a map with:
+     * "items"    -> QVariantList the page rows
+     * "next"     -> QString the opaque token to load the next page, or a empty string if is the last page
+     * "previous" -> QString the opaque token to load the previous page, or a empty string if is the first page
+     */
+    Q_INVOKABLE QVariantMap selectPage(const QString &tableName, const QVariantMap &where = QVariantMap(), const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief encodePageToken
+     * Create a opaque page token with the primary key value, used by keyset pagination.
+     * @param pkValue QVariant the primary key value
+     * @return QString the token or a empty string if pkValue is invalid
+     */
+    static QString encodePageToken(const QVariant &pkValue);
+
+    /**
+     * @brief decodePageToken
+     * Return the primary key value saved in a page token created by encodePageToken.
+     * @param token QString
+     * @return QVariant a invalid QVariant if the token is empty or invalid
+     */
+    static QVariant decodePageToken(const QString &token);
+
+    /**
+     * @brief pageTokens
+     * Create the "next" and "previous" tokens of a keyset page, used by selectPage and AsyncSelect.
+     * The "next" token is empty at the end of the table and the "previous" token is empty in the first page.
+     * @param args QVariantMap the select arguments, with the "after" or "before" token and the "limit"
+     * @param rows int the number of selected rows
+     * @param firstPk QVariant the primary key of the first row
+     * @param lastPk QVariant the primary key of the last row
+     * @return QVariantMap a map with the "next" and "previous" tokens
+     */
+    static QVariantMap pageTokens(const QVariantMap &args, int rows, const QVariant &firstPk, const QVariant &lastPk);
+
+    /**
+     * @brief pkColumn
+     * Return the "pkColumn" argument (default is "id") used by the keyset pagination. The column is put in the query string,
+     * so return a empty string (and log the error) if is not a valid column name.
+     * @param args QVariantMap the select arguments
+     * @return QString
+     */
+    QString pkColumn(const QVariantMap &args);
+
     /**
      * @brief insert
      * Execute a SQL insert operation in database into 'tableName' using a map with column_name->value.
      * This method uses addBindValue from QSqlQuery object to prepared statement, that prevent SQL injection or invalid data type.
      * @param tableName QString the table name to save insertData data parameter in database
      * @param insertData QVariantMap a map with column_name -> value to insert in database
+     * @param ignoreConflicts bool if true, the row is not inserted (and zero is returned) when the primary key or a unique column already exists.
+     * The check is made by sqlite using the table index, without select the row before the insert.
      * @return int return the insert ID if table has primary key ID column.
      */
-    Q_INVOKABLE int insert(const QString &tableName, const QVariantMap &insertData);
+    Q_INVOKABLE int insert(const QString &tableName, const QVariantMap &insertData, bool ignoreConflicts = false);
+
+    /**
+     * @brief insertBatch
+     * Execute a list of SQL insert operations into 'tableName' in a single transaction.
+     * Each item of 'rows' needs to be a map with column_name->value. Rows with the same columns
+     * reuse the same prepared statement, so the query is prepared only once for all the batch.
+     * If a row cannot be inserted (constraint violation for example), the row is ignored and counted as failed.
+     * The batchProgress signal is emitted for each 500 processed rows and at the end.
+     * @param tableName QString the table name to save the rows
+     * @param rows QVariantList a list of QVariantMap with column_name -> value to insert in database
+     * @param ignoreConflicts bool if true, the rows with a existing primary key (or unique column) are skipped and counted as ignored
+     * @return QVariantMap a map with:
+     * "inserted" -> integer the number of inserted rows
+     * "ignored"  -> integer the number of rows skipped because already exists (only if ignoreConflicts is true)
+     * "failed"   -> integer the number of rows not inserted because of errors
+     * "ids"      -> QVariantList the insert ID of each inserted row
+     */
+    Q_INVOKABLE QVariantMap insertBatch(const QString &tableName, const QVariantList &rows, bool ignoreConflicts = false);
+
+    /**
+     * @brief upsert
+     * Insert the 'data' in 'tableName' or, if a row with the same 'conflictColumns' values already exists, update
+     * the row with the other columns of 'data'. The operation is a single atomic statement with bound values:
+     * 'INSERT INTO t(...) VALUES(...) ON CONFLICT(conflictColumns) DO UPDATE SET column = excluded.column'.
+     * The 'conflictColumns' needs to be the table primary key or have a unique index. Needs SQLITE 3.24 or greater.
+     * @param tableName QString the table name
+     * @param data QVariantMap a map with column_name -> value to insert or update
+     * @param conflictColumns QStringList the primary key or unique columns. The default is "id".
+     * @return int the number of inserted or updated rows
+     */
+    Q_INVOKABLE int upsert(const QString &tableName, const QVariantMap &data, const QStringList &conflictColumns = QStringList());
+
+    /**
+     * @brief upsertBatch
+     * Execute upsert(...) for each item of 'rows' in a single transaction. Rows with the same columns
+     * reuse the same prepared statement. The batchProgress signal is emitted for each 500 processed rows and at the end.
+     * @param tableName QString the table name
+     * @param rows QVariantList a list of QVariantMap with column_name -> value to insert or update
+     * @param conflictColumns QStringList the primary key or unique columns. The default is "id".
+     * @return QVariantMap a map with:
+     * "affected" -> integer the number of inserted or updated rows
+     * "failed"   -> integer the number of rows not saved because of errors
+     */
+    Q_INVOKABLE QVariantMap upsertBatch(const QString &tableName, const QVariantList &rows, const QStringList &conflictColumns = QStringList());
+
+    /**
+     * @brief importJson
+     * Import a json array or a NDJSON (one json object by line) from 'url' into 'tableName' in a JsonImporter thread.
+     * The source is read and parsed in chunks and the rows are saved in batches (with insertBatch or upsertBatch),
+     * so the memory used does not depends of the source size. The url can be a local file, a resource (qrc:/) or a http(s) url.
+     * The importProgress signal is emitted after each batch and the importFinished signal at the end.
+     * The 'options' map accepts:
+     * "batchSize"       -> integer the number of rows in each transaction. The default is 500.
+     * "fields"          -> QVariantMap to rename the json keys to the column names (json_key -> column_name).
+     *                      The keys that are not table columns are ignored.
+     * "mode"            -> QString "insert" (the default) or "upsert"
+     * "ignoreConflicts" -> bool ignore the rows with a existing primary key, in "insert" mode. The default is true.
+     * "conflictColumns" -> QStringList the upsert conflict columns. The default is "id".
+     * "headers"         -> QVariantMap the request headers, for http urls
+     * @param tableName QString the table name
+     * @param url QUrl the source url
+     * @param options QVariantMap the import options
+     * @return int the import id, used by cancelImport and sent in the import signals
+     */
+    Q_INVOKABLE int importJson(const QString &tableName, const QUrl &url, const QVariantMap &options = QVariantMap());
+
+    /**
+     * @brief importJson
+     * @overload
+     * Import a json array or a NDJSON from a opened 'device'. The device is read by the importer thread,
+     * so needs to be a file or a buffer and needs to be kept alive until the importFinished signal.
+     * @param tableName QString the table name
+     * @param device QIODevice* the source
+     * @param options QVariantMap the import options
+     * @return int the import id
+     */
+    int importJson(const QString &tableName, QIODevice *device, const QVariantMap &options = QVariantMap());
+
+    /**
+     * @brief cancelImport
+     * Stop the import with 'importId'. The rows of the committed batches are kept.
+     * @param importId int
+     */
+    Q_INVOKABLE void cancelImport(int importId);
+
+    /**
+     * @brief contains
+     * Check if exists some row in 'tableName' with 'column' equal to 'value', using a prepared 'SELECT 1 ... LIMIT 1' statement.
+     * If the column is the primary key (or has a index), the check uses the index and has the same cost for any table size.
+     * @param tableName QString the table name
+     * @param column QString the column name, like the primary key column
+     * @param value QVariant the value to search
+     * @return bool
+     */
+    Q_INVOKABLE bool contains(const QString &tableName, const QString &column, const QVariant &value);
+
+    /**
+     * @brief count
+     * Return the number of rows in 'tableName' using 'SELECT count(*)', filtered by 'where' and 'args' (see select(...))
+     * @param tableName QString the table name
+     * @param where QVariantMap a map with column name and column value to build the query predicates.
+     * @param args QVariantMap the select(...) arguments, like "whereComparator"
+     * @return int
+     */
+    Q_INVOKABLE int count(const QString &tableName, const QVariantMap &where = QVariantMap(), const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief search
+     * Execute a full text search in the 'searchColumns' of 'tableName' (see createSearchIndex), returning the rows ordered by relevance.
+     * Each row has the table columns and:
+     * "snippet" -> QString the piece of text with the matched terms between '<b>' and '</b>' (to be showed as StyledText)
+     * "rank"    -> double the bm25 rank, where the lower value is the most relevant row
+     * Each word of the text is a prefix term, and the rows needs to contain all words.
+     * The matched rows are filtered by 'where', like in select(...), but each column is compared only with '='.
+     * @param tableName QString the table name
+     * @param text QString the text typed by the user
+     * @param where QVariantMap the column_name -> value used to filter the matched rows
+     * @param args QVariantMap the "limit" and "offset" arguments
+     * @return QVariantList of QVariantMap with column_name -> value
+     */
+    Q_INVOKABLE QVariantList search(const QString &tableName, const QString &text, const QVariantMap &where = QVariantMap(), const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief searchCursor
+     * Execute the same query of search(...), but return the executed statement to be iterated by the caller, like selectCursor.
+     * @param tableName QString the table name
+     * @param text QString the text typed by the user
+     * @param where QVariantMap the column_name -> value used to filter the matched rows
+     * @param args QVariantMap the "limit" and "offset" arguments
+     * @return QSqlQuery* the executed statement or nullptr if the query cannot be executed
+     */
+    QSqlQuery *searchCursor(const QString &tableName, const QString &text, const QVariantMap &where = QVariantMap(), const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief setCborColumns
+     * Set the columns of 'tableName' saved as CBOR (binary json), instead of json text. The object and array values of these
+     * columns are saved by DatabaseComponent as CBOR blobs, that are smaller and faster to decode than the json strings.
+     * The existing rows are converted in a single transaction: the json values of the new columns to CBOR and the CBOR values
+     * of the removed columns back to json. The columns are saved in the 'storage_formats' table.
+     * The CBOR values can not be filtered by json paths (see select), because json_extract reads only json text, so
+     * the json paths of these columns are ignored and a column with a json index (see createJsonIndex) is rejected.
+     * Called by PluginDatabaseTableCreator for each table in the "cborColumns" object of the plugin config.json.
+     * Needs Qt 5.12 (QCborValue). With older Qt versions, the columns are kept as json.
+     * @param tableName QString the table name
+     * @param columns QStringList the columns to save as CBOR, or a empty list to save all columns as json
+     * @return bool true if the columns was set and the rows converted
+     */
+    bool setCborColumns(const QString &tableName, const QStringList &columns);
+
+    /**
+     * @brief cborColumns
+     * Return the columns of 'tableName' saved as CBOR (see setCborColumns)
+     * @param tableName QString the table name
+     * @return QStringList
+     */
+    Q_INVOKABLE QStringList cborColumns(const QString &tableName);
+
+    /**
+     * @brief storageBenchmark
+     * Compare the json and CBOR formats using the values of 'column' from the first 'rows' rows of 'tableName'.
+     * Return a map with "rows" and the "json" and "cbor" maps with:
+     * "bytes"    -> integer the total size of the encoded values
+     * "encodeMs" -> double the time to encode all values
+     * "decodeMs" -> double the time to decode all values to QVariant
+     * @param tableName QString the table name
+     * @param column QString a column with json or CBOR values
+     * @param rows int the max number of rows to read
+     * @return QVariantMap
+     */
+    Q_INVOKABLE QVariantMap storageBenchmark(const QString &tableName, const QString &column, int rows = 1000);
+
+    /**
+     * @brief encodeCbor
+     * Encode 'value' (a map, list or scalar) as CBOR, prefixed by the CBOR self-describe tag.
+     * Return a empty QByteArray if CBOR is not supported by the Qt version.
+     * @param value QVariant
+     * @return QByteArray
+     */
+    static QByteArray encodeCbor(const QVariant &value);
+
+    /**
+     * @brief isCborDocument
+     * Return true if 'value' starts with the CBOR self-describe tag (0xD9D9F7), added by encodeCbor.
+     * The tag is never the start of a json text, so the json and CBOR values can be in the same column.
+     * @param value QByteArray
+     * @return bool
+     */
+    static bool isCborDocument(const QByteArray &value);
+
+    /**
+     * @brief isJsonDocument
+     * Return true if 'value' starts with '{' or '[', ignoring the whitespaces. Only these values are parsed as json,
+     * so the QJsonDocument is not created for the plain strings, numbers and empty values of the json columns.
+     * @param value QByteArray the column value
+     * @return bool
+     */
+    static bool isJsonDocument(const QByteArray &value);
+
+    /**
+     * @brief decodeValue
+     * Return the CBOR blob values decoded to QVariantMap or QVariantList, and the other values without changes.
+     * Used by resultSet, AsyncSelect and TableModel to read the CBOR columns.
+     * @param value QVariant a column value
+     * @return QVariant
+     */
+    static QVariant decodeValue(const QVariant &value);
+
+    /**
+     * @brief createJsonIndex
+     * Create a expression index for a json path, like "profile.city", used by the select queries that filter or order by the
+     * same path. The index is named '<tableName>_profile_city_index' and is created only if not exists.
+     * The paths of the CBOR columns (see setCborColumns) are rejected.
+     * Called by PluginDatabaseTableCreator for each path in the "jsonIndexes" object of the plugin config.json.
+     * @param tableName QString the table name
+     * @param jsonPath QString the column name and the json keys separated by dot
+     * @return bool true if the index was created or already exists
+     */
+    bool createJsonIndex(const QString &tableName, const QString &jsonPath);
+
+    /**
+     * @brief createSearchIndex
+     * Create (or recreate, if the columns was changed) the FTS5 index of 'tableName': a external content table named
+     * '<tableName>_fts' with the 'columns', and the triggers to keep the index updated on each insert, update and delete.
+     * The existing rows are indexed once, in the same transaction. The definition is saved in the 'search_indexes' table.
+     * If the sqlite library was built without FTS5, the search uses LIKE in the 'columns' (a full table scan).
+     * Called by PluginDatabaseTableCreator for each table in the "searchColumns" object of the plugin config.json.
+     * @param tableName QString the table name
+     * @param columns QStringList the text columns to be searched
+     * @return bool true if the index was created or is up to date
+     */
+    bool createSearchIndex(const QString &tableName, const QStringList &columns);
+
+    /**
+     * @brief searchColumns
+     * Return the searchable columns of 'tableName', or a empty list if the table has no search index.
+     * @param tableName QString the table name
+     * @return QStringList
+     */
+    Q_INVOKABLE QStringList searchColumns(const QString &tableName);
+
+    /**
+     * @brief syncState
+     * Return the delta sync state of 'tableName', saved by setSyncState in 'sync_state' table, as a map with:
+     * "watermark" -> QString the updated_at value of the last synchronized row, or a empty string to a full sync
+     * "lastId"    -> QString the primary key of the last synchronized row, to break the updated_at ties
+     * "syncedAt"  -> integer the time of the last saved page, in milliseconds since epoch
+     * @param tableName QString the table name
+     * @return QVariantMap
+     */
+    Q_INVOKABLE QVariantMap syncState(const QString &tableName);
+
+    /**
+     * @brief setSyncState
+     * Save the delta sync watermark of 'tableName'. Called by SyncEngine in the same transaction of the synchronized rows,
+     * so the watermark is never ahead of the saved rows. A null 'watermark' remove the state and the next sync will be a full sync.
+     * @param tableName QString the table name
+     * @param watermark QVariant the updated_at value of the last synchronized row
+     * @param lastId QVariant the primary key of the last synchronized row
+     * @return bool
+     */
+    Q_INVOKABLE bool setSyncState(const QString &tableName, const QVariant &watermark, const QVariant &lastId = QVariant());
+
+    /**
+     * @brief transaction
+     * Begin a transaction in the current thread connection. Uses QSqlDatabase::transaction(), or "BEGIN IMMEDIATE"
+     * if 'immediate' is true. The transactions that read before write (like the writes in WriteQueue) needs to be immediate,
+     * otherwise the write fails with SQLITE_BUSY_SNAPSHOT if other connection commits after the read.
+     * The tableChanged signals of the writes in the transaction are emitted after the commit.
+     * @param immediate bool if true, take the write lock in the begin, waiting the busy_timeout
+     * @return bool true if the transaction was started, otherwise false
+     */
+    Q_INVOKABLE bool transaction(bool immediate = false);
+
+    /**
+     * @brief commit
+     * Commit the transaction started in the current thread connection. Uses QSqlDatabase::commit().
+     * @return bool true if the transaction was committed, otherwise false
+     */
+    Q_INVOKABLE bool commit();
+
+    /**
+     * @brief rollback
+     * Rollback the transaction started in the current thread connection. Uses QSqlDatabase::rollback().
+     * @return bool true if the transaction was rolled back, otherwise false
+     */
+    Q_INVOKABLE bool rollback();
 
     /**
      * @brief remove
-     * Execute a simple SQL delete operation in database, using the tableName with where map + operators to build the string query
+     * Execute a simple SQL delete operation in database, using the tableName with where map + operators to build the string query.
+     * The values are bound to the prepared statement (see removeWhere).
      * @param tableName QString the table name to delete data
      * @param where QVariantMap a map with data to be deleted
      * @param whereComparator QString the operator to use as compare operator at where clausule in query string
-     * @return
+     * @return int the number of removed rows
      */
     Q_INVOKABLE int remove(const QString &tableName, const QVariantMap &where, const QString &whereComparator = QStringLiteral("="));
 
+    /**
+     * @brief removeWhere
+     * Remove the rows of 'tableName' that match the 'where' predicates, binding the values in a cached prepared statement.
+     * The keys can be columns or json paths (like "profile.city") and a list value is compared with IN, like {"id": [1, 2, 3]}.
+     * The args accepts:
+     * "whereOperator"   -> QString "AND" (the default) or "OR"
+     * "whereComparator" -> QString "=" (the default), "!=", "<>", "<", ">", "<=", ">=" or "LIKE". With "!=", the lists are compared with NOT IN.
+     *                      The LIKE values are bound as is, so needs to contains the wildcards, like "%mouse%".
+     * @param tableName QString the table name
+     * @param where QVariantMap a map with column_name -> value
+     * @param args QVariantMap the where operator and comparator
+     * @return int the number of removed rows
+     */
+    Q_INVOKABLE int removeWhere(const QString &tableName, const QVariantMap &where, const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief removeIds
+     * Remove the rows of 'tableName' with the primary key in 'ids', in chunks of 500 ids by 'DELETE ... WHERE pk IN (...)'
+     * and in a single transaction (or in the caller transaction, if is running). The full chunks reuse the same prepared statement,
+     * so remove 5000 rows executes 10 statements instead of 5000. The tableChanged change "where" has the list of ids of each chunk.
+     * @param tableName QString the table name
+     * @param ids QVariantList the primary key values
+     * @param pkColumn QString the primary key column. The default is "id".
+     * @return QVariantMap a map with:
+     * "removed" -> integer the number of removed rows
+     * "failed"  -> integer the number of ids not removed because of errors (all ids, since the transaction is rolled back)
+     */
+    Q_INVOKABLE QVariantMap removeIds(const QString &tableName, const QVariantList &ids, const QString &pkColumn = QStringLiteral("id"));
+
     /**
      * @brief update
      * Execute a SQL update operation in database, using the tableName and updateData to save based on where predicates.
@@ -204,16 +889,63 @@ public:
 
     /**
      * @brief createTable
-     * This method ready a ".sql" file pass in filePath parameter.
-     * Will be create a string query and execute using queryExec(QString&) to create the database table.
-     *
-     * @WARNING!
-     * Any internal database error for the file will be ignored!
-     * Your needs to prevent any errors from the SQL commands into this file.
+     * This method ready a ".sql" file pass in filePath parameter, split the statements with splitStatements
+     * and execute all statements in a single transaction. If some statement fails, the transaction is rolled back.
+     * To create tables from plugins, uses migrate(...), that execute each file only once.
      * @param filePath QString the path to ".sql" file in operating system.
      */
     void createTable(const QString &filePath);
 
+    /**
+     * @brief migrate
+     * Apply the pending database migrations of the plugin in 'pluginDirPath'. The migrations are:
+     * version 1 -> the "plugin_table.sql" file;
+     * version N -> the "migrations/N_description.sql" files, like "migrations/2_add_email_column.sql".
+     * The applied version of each plugin is saved in the 'schema_migrations' table, and only the files with a greater
+     * version are read and executed, in ascending order. Each migration is executed in a single transaction with the
+     * version update, so a failed migration is rolled back and the next execution try it again.
+     * If the schema is up to date, the cost is one indexed lookup in 'schema_migrations'.
+     * When a plugin has no version saved and all tables of "plugin_table.sql" already exists (the databases created
+     * before the migrations), the version 1 is saved as baseline without execute the file.
+     * @param pluginName QString the plugin name (the plugin directory name)
+     * @param pluginDirPath QString the plugin directory absolute path
+     * @return bool true if all pending migrations was applied
+     */
+    bool migrate(const QString &pluginName, const QString &pluginDirPath);
+
+    /**
+     * @brief schemaVersion
+     * Return the last migration version applied for 'pluginName', or zero if no migration was applied.
+     * @param pluginName QString the plugin name
+     * @return int
+     */
+    Q_INVOKABLE int schemaVersion(const QString &pluginName);
+
+    /**
+     * @brief isSchemaReady
+     * Return false while the plugins migrations are running. The tables can be used after the schemaReady signal.
+     * @return bool
+     */
+    Q_INVOKABLE bool isSchemaReady() const;
+
+    /**
+     * @brief setSchemaReady
+     * Set the schema state. PluginManager set to false before start the migrations and
+     * PluginDatabaseTableCreator set to true after apply all migrations. When set to true, the schemaReady signal is emitted.
+     * @param schemaReady bool
+     */
+    void setSchemaReady(bool schemaReady);
+
+    /**
+     * @brief splitStatements
+     * Split a SQL script in a list of complete statements, using the same rules of sqlite3_complete():
+     * the semicolons inside strings, quoted identifiers, comments and trigger bodies does not finish the statement.
+     * The empty statements are ignored.
+     * @param sql QString the SQL script
+     * @return QStringList
+     */
+    static QStringList splitStatements(const QString &sql);
+
     /**
      * @brief lastQuery
      * get the last query executed in database. Uses the QSqlQuery::lastQuery().
@@ -227,6 +959,66 @@ public:
      */
     QString lastError() const;
 
+    /**
+     * @brief statementCacheStats
+     * Return the prepared statements cache counters as a map with:
+     * "hits"   -> integer the number of queries executed with a cached prepared statement
+     * "misses" -> integer the number of queries that needs to be prepared
+     * @return QVariantMap
+     */
+    Q_INVOKABLE QVariantMap statementCacheStats() const;
+
+    /**
+     * @brief resultCacheKey
+     * Return the key of a select result set in the ResultCache: the table name, the 'resultFormat', the query built
+     * by selectQueryString and the bound values. Return a empty string if the selection can not be cached.
+     * @param tableName QString the name of the table
+     * @param where QVariantMap the select(...) filter
+     * @param args QVariantMap the select(...) arguments
+     * @param resultFormat QString the format of the rows, to not share the entries between callers that read the rows in different ways
+     * @return QString
+     */
+    QString resultCacheKey(const QString &tableName, const QVariantMap &where, const QVariantMap &args, const QString &resultFormat);
+
+    /**
+     * @brief resultCache
+     * Return the cache of select result sets, used by select(...) and the AsyncSelect workers
+     * @return ResultCache*
+     */
+    ResultCache *resultCache() const;
+
+    /**
+     * @brief resultCacheStats
+     * Return the result cache counters (see ResultCache::stats)
+     * @return QVariantMap
+     */
+    Q_INVOKABLE QVariantMap resultCacheStats() const;
+
+    /**
+     * @brief profileQuery
+     * Send the query execution to the QueryProfiler (if enabled). If the query is slow and the query plan
+     * was not captured yet, execute 'EXPLAIN QUERY PLAN' with the same bound values in the current thread connection.
+     * @param sqlQuery QSqlQuery* the executed query
+     * @param elapsedNs qint64 the execution time in nanoseconds, including the time to read the rows
+     * @param rows int the rows returned or affected. If is less than zero, is not counted.
+     */
+    void profileQuery(QSqlQuery *sqlQuery, qint64 elapsedNs, int rows);
+
+    /**
+     * @brief profilerReport
+     * Return the QueryProfiler statistics for each normalized SQL (see QueryProfiler::report)
+     * @return QVariantMap
+     */
+    Q_INVOKABLE QVariantMap profilerReport() const;
+
+    /**
+     * @brief dumpProfilerReport
+     * Save the QueryProfiler statistics as json in 'filePath'
+     * @param filePath QString
+     * @return bool
+     */
+    Q_INVOKABLE bool dumpProfilerReport(const QString &filePath);
+
 signals:
     /**
      * @brief logMessage
@@ -235,6 +1027,58 @@ signals:
      */
     void logMessage(const QString &message);
 
+    /**
+     * @brief batchProgress
+     * Emitted by insertBatch and upsertBatch while the rows are saved in database
+     * @param tableName QString the table name where the rows are inserted
+     * @param processed int the number of rows already processed
+     * @param total int the total number of rows in the batch
+     */
+    void batchProgress(const QString &tableName, int processed, int total);
+
+    /**
+     * @brief importProgress
+     * Emitted by importJson after each batch of rows is saved
+     * @param importId int the import id
+     * @param tableName QString the table name
+     * @param rows int the number of json objects read
+     * @param bytes qint64 the number of bytes read
+     * @param totalBytes qint64 the source size, or -1 if unknown
+     */
+    void importProgress(int importId, const QString &tableName, int rows, qint64 bytes, qint64 totalBytes);
+
+    /**
+     * @brief importFinished
+     * Emitted at the end of a importJson, with the result map described in JsonImporter::importFinished
+     * @param importId int the import id
+     * @param tableName QString the table name
+     * @param result QVariantMap
+     */
+    void importFinished(int importId, const QString &tableName, const QVariantMap &result);
+
+    /**
+     * @brief schemaReady
+     * Emitted after all plugins migrations are applied and the tables can be used.
+     * The signal is emitted from the migration thread.
+     */
+    void schemaReady();
+
+    /**
+     * @brief tableChanged
+     * Emitted after the rows of 'tableName' are changed by insert, insertBatch, update, upsert, upsertBatch or remove.
+     * The changes made in a transaction are emitted once, after the commit, coalesced by rowid (see coalesceChanges), and discarded after the rollback.
+     * Each change is a map with:
+     * "op"    -> QString "insert", "update", "upsert" or "remove"
+     * "rowid" -> integer the changed row id. Each changed row has your own change. Only the tables WITHOUT ROWID
+     *            (or a upsert without the conflict columns in data) publish a single change without "rowid".
+     * "data"  -> QVariantMap the inserted or updated column_name -> value (insert, update and upsert)
+     * "where" -> QVariantMap the filter condition of the changed rows (update and remove). A list value is a IN condition, like the removeIds chunks.
+     * The signal is emitted from the thread that made the changes.
+     * @param tableName QString the changed table
+     * @param changes QVariantList the list of changes
+     */
+    void tableChanged(const QString &tableName, const QVariantList &changes);
+
 private:
     /**
      * @brief m_instance
@@ -250,23 +1094,108 @@ private:
     QString m_databaseFileName;
 
     /**
-     * @brief m_qsqlQuery
-     * This object handle SQL DML operations executing the queries operations.
-     * The QSqlQuery class provides a means of executing and manipulating SQL statements.
-     * QSqlQuery encapsulates the functionality involved in creating, navigating and
-     * retrieving data from SQL queries which are executed on a QSqlDatabase.
+     * @brief m_connectionPool
+     * Handle the SQLITE connections, giving to each thread your own named QSqlDatabase connection
+     * and your own QSqlQuery object. The connections are reused across calls from the same thread
+     * and the number of opened connections is limited by the pool size.
+     */
+    ConnectionPool *m_connectionPool;
+
+    /**
+     * @brief m_resultCache
+     * Keeps the select result sets until the table is changed
+     */
+    ResultCache *m_resultCache;
+
+    /**
+     * @brief m_statementCacheHits
+     * Counts the queries executed with a prepared statement from the cache
+     */
+    QAtomicInt m_statementCacheHits;
+
+    /**
+     * @brief m_statementCacheMisses
+     * Counts the queries that needs to be prepared, because is not in the cache
+     */
+    QAtomicInt m_statementCacheMisses;
+
+    /**
+     * @brief m_schemaReady
+     * Set to 0 (zero) while the plugins migrations are running
+     */
+    QAtomicInt m_schemaReady;
+
+    /**
+     * @brief The SearchIndex struct
+     * The search index definition of a table, loaded from 'search_indexes' table
+     */
+    struct SearchIndex {
+        QStringList columns;
+        bool isFts;
+    };
+
+    /**
+     * @brief searchIndex
+     * Return the search index definition of 'tableName', read once from 'search_indexes' table and kept in m_searchIndexes
+     * @param tableName QString the table name
+     * @return SearchIndex
+     */
+    SearchIndex searchIndex(const QString &tableName);
+
+    /**
+     * @brief m_searchIndexes
+     * Keeps the search index definition of each table, used by the search workers threads
+     */
+    QHash<QString, SearchIndex> m_searchIndexes;
+
+    /**
+     * @brief m_searchMutex
+     * Protect the m_searchIndexes access
+     */
+    QMutex m_searchMutex;
+
+    /**
+     * @brief convertDocument
+     * Convert a json text value to CBOR (if 'toCbor' is true) or a CBOR value to json text.
+     * The values in the other format (and the plain values) are returned without changes.
+     * @param value QVariant the column value
+     * @param toCbor bool the target format
+     * @return QVariant
+     */
+    static QVariant convertDocument(const QVariant &value, bool toCbor);
+
+    /**
+     * @brief m_cborColumns
+     * Keeps the CBOR columns of each table, loaded from 'storage_formats' table
+     */
+    QHash<QString, QStringList> m_cborColumns;
+
+    /**
+     * @brief m_cborMutex
+     * Protect the m_cborColumns access
+     */
+    QMutex m_cborMutex;
+
+    /**
+     * @brief startImport
+     * Connect the 'importer' signals, keep the importer in m_imports and start the importer thread
+     * @param importId int the import id
+     * @param importer JsonImporter*
+     * @return int the import id
+     */
+    int startImport(int importId, JsonImporter *importer);
+
+    /**
+     * @brief m_lastImportId
+     * The id of the last import started by importJson
      */
-    QSqlQuery m_qsqlQuery;
+    QAtomicInt m_lastImportId;
 
     /**
-     * @brief m_qSqlDatabase
-     * This object handle SQLITE database creation and connections.
-     * The QSqlDatabase class provides an interface for accessing a database through a connection.
-     * An instance of QSqlDatabase represents the connection,
-     * providing access to the database via one of the supported database drivers,
-     * which are derived from QSqlDriver.
+     * @brief m_imports
+     * The running imports by id, used by cancelImport
      */
-    QSqlDatabase m_qSqlDatabase;
+    QHash<int, QPointer<JsonImporter> > m_imports;
 };
 
 #endif // DATABASE_H
@@ -1,7 +1,12 @@
 #include "databasecomponent.h"
 #include "database.h"
 #include "asyncselect.h"
+#include "databasemaintenance.h"
+#include "queryexecutor.h"
+#include "resultcache.h"
+#include "writequeue.h"
 
+#include <QElapsedTimer>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -10,39 +15,74 @@
 DatabaseComponent::DatabaseComponent(QObject *parent) : QObject(parent)
   ,m_totalItens(0)
   ,m_database(Database::instance())
+  ,m_chunkSize(200)
+  ,m_priority(0)
+  ,m_model(new TableModel(this))
 {
+    // the writes results are sent from the writer thread and received in this object thread
+    connect(WriteQueue::instance(), &WriteQueue::writeFinished, this, &DatabaseComponent::onWriteFinished, Qt::QueuedConnection);
+
+    // the maintenance is scheduled by the table changes and the application state, after the first component is created
+    DatabaseMaintenance::instance();
+
+    // forward only the changes of this component table
+    connect(m_database, &Database::tableChanged, this, [this](const QString &tableName, const QVariantList &changes) {
+        if (tableName == m_tableName)
+            emit tableChanged(changes);
+    }, Qt::QueuedConnection);
+
+    // forward only the imports started by this component
+    connect(m_database, &Database::importProgress, this, [this](int importId, const QString &tableName, int rows, qint64 bytes, qint64 totalBytes) {
+        Q_UNUSED(tableName)
+        if (m_imports.contains(importId))
+            emit importProgress(importId, rows, bytes, totalBytes);
+    });
+    connect(m_database, &Database::importFinished, this, [this](int importId, const QString &tableName, const QVariantMap &result) {
+        if (!m_imports.remove(importId))
+            return;
+        m_totalItens = m_database->count(tableName);
+        emit importFinished(importId, result);
+    });
+}
+
+DatabaseComponent::~DatabaseComponent()
+{
+    // the running workers are deleted by itself after the run finish
+    cancel();
 }
 
 void DatabaseComponent::load()
 {
+    if (m_tableName.isEmpty())
+        return;
+
     // load the table columns names
     m_tableColumns = m_database->tableColumns(m_tableName);
+    m_cborColumns = m_database->cborColumns(m_tableName);
+    m_model->setTable(m_tableName, m_tableColumns, m_jsonColumns);
 
-    // uses the generic query execution and load the result with 'resultSet' method
-    m_database->queryExec(QStringLiteral("select id from ") + m_tableName);
-    QVariantList result(m_database->resultSet());
-
-    // keeps the number of saved itens
-    m_totalItens = result.size();
-    // if total entries is zero or above 500, we cannot set
-    // the table keys to 'm_savedPks' to optimize the memory consumption!
-    if (!m_totalItens || m_totalItens > 1000)
-        return;
-
-    // set all primary keys that can be used to
-    // check if some data is already in database
-    QString pkColumn(QStringLiteral("id"));
-    if (!m_pkColumn.isEmpty())
-        pkColumn = m_pkColumn;
-    for (int i = 0; i < m_totalItens; ++i)
-        m_savedPks << result[i].toMap().value(pkColumn);
+    // keeps the number of saved itens. The primary keys are not loaded to memory,
+    // the existence check is made by the table index (see containsId and insert)
+    m_totalItens = m_database->count(m_tableName);
 }
 
 void DatabaseComponent::setTableName(const QString &tableName)
 {
     m_tableName = tableName;
-    if (!m_tableName.isEmpty())
+    disconnect(m_schemaReadyConnection);
+    if (m_tableName.isEmpty())
+        return;
+
+    // while the plugins migrations are running, the table can not exists yet.
+    // The connection is made before check the state, so the signal is never lost
+    m_schemaReadyConnection = connect(m_database, &Database::schemaReady, this, [this]() {
+        disconnect(m_schemaReadyConnection);
+        load();
+    }, Qt::QueuedConnection);
+    if (m_database->isSchemaReady()) {
+        disconnect(m_schemaReadyConnection);
         load();
+    }
 }
 
 void DatabaseComponent::setPkColumn(const QString &pkColumn)
@@ -53,11 +93,15 @@ void DatabaseComponent::setPkColumn(const QString &pkColumn)
 void DatabaseComponent::setJsonColumns(const QStringList &jsonColumns)
 {
     m_jsonColumns = jsonColumns;
+    if (!m_tableName.isEmpty())
+        m_model->setTable(m_tableName, m_tableColumns, m_jsonColumns);
 }
 
 bool DatabaseComponent::containsId(const QVariant &item)
 {
-    return m_savedPks.contains(item);
+    if (m_tableName.isEmpty())
+        return false;
+    return m_database->contains(m_tableName, m_pkColumn.isEmpty() ? QStringLiteral("id") : m_pkColumn, item);
 }
 
 void DatabaseComponent::parseData(QVariantMap *data)
@@ -67,7 +111,11 @@ void DatabaseComponent::parseData(QVariantMap *data)
     foreach (const QString &column, m_tableColumns) {
         if (!data->contains(column))
             data->remove(column);
-        if (data->value(column).userType() == QMetaType::QVariantMap) {
+        if (m_cborColumns.contains(column) && data->value(column).userType() != QMetaType::QByteArray) {
+            // the object or array is saved as a CBOR blob, decoded by Database::decodeValue
+            if (data->value(column).userType() == QMetaType::QVariantMap || data->value(column).userType() == QMetaType::QVariantList)
+                data->insert(column, Database::encodeCbor(data->value(column)));
+        } else if (data->value(column).userType() == QMetaType::QVariantMap) {
             // if column data has a json object, parse from map to minified string
             QJsonDocument doc(QJsonObject::fromVariantMap(data->value(column).toMap()));
             data->insert(column, QVariant(doc.toJson(QJsonDocument::Compact)));
@@ -83,40 +131,168 @@ int DatabaseComponent::insert(const QVariantMap &data)
 {
     if (m_tableName.isEmpty())
         return 0;
-    QString pkColumn(QStringLiteral("id"));
-    if (!m_pkColumn.isEmpty())
-        pkColumn = m_pkColumn;
-    QVariant id = data.value(pkColumn);
-    if (m_tableName.isEmpty() || (id.isValid() && m_savedPks.size() && m_savedPks.contains(id)))
-        return 0;
     QVariantMap insertData(data);
     parseData(&insertData);
-    int insertId = m_database->insert(m_tableName, insertData);
-    if (insertData.size() && insertId) {
-        // if the string pk column is not defined
-        // append th last insert id value
-        if (m_pkColumn.isEmpty())
-            m_savedPks << insertId;
-        else
-            m_savedPks << id;
-        m_totalItens = m_savedPks.size();
-    }
+    // the rows with a existing primary key are ignored by sqlite
+    int insertId = m_database->insert(m_tableName, insertData, true);
+    if (insertData.size() && insertId)
+        ++m_totalItens;
     return insertId;
 }
 
+QVariantMap DatabaseComponent::insertBatch(const QVariantList &items)
+{
+    if (m_tableName.isEmpty())
+        return QVariantMap();
+
+    QVariantMap item;
+    QVariantList rows;
+    rows.reserve(items.size());
+    foreach (const QVariant &value, items) {
+        item = value.toMap();
+        parseData(&item);
+        rows << item;
+    }
+
+    // forward the progress only for this component table
+    QMetaObject::Connection connection = connect(m_database, &Database::batchProgress, this, [this](const QString &tableName, int processed, int total) {
+        if (tableName == m_tableName)
+            emit insertProgress(processed, total);
+    });
+    // the rows with a existing primary key are ignored by sqlite and counted as "ignored"
+    QVariantMap result(m_database->insertBatch(m_tableName, rows, true));
+    disconnect(connection);
+
+    m_totalItens += result.value(QStringLiteral("inserted")).toInt();
+    return result;
+}
+
+int DatabaseComponent::upsert(const QVariantMap &data)
+{
+    if (m_tableName.isEmpty())
+        return 0;
+    QVariantMap upsertData(data);
+    parseData(&upsertData);
+    // a single statement, without check if the row exists. So, the totalItens is not changed
+    return m_database->upsert(m_tableName, upsertData, QStringList(m_pkColumn.isEmpty() ? QStringLiteral("id") : m_pkColumn));
+}
+
+QVariantMap DatabaseComponent::upsertBatch(const QVariantList &items)
+{
+    if (m_tableName.isEmpty())
+        return QVariantMap();
+
+    QVariantMap item;
+    QVariantList rows;
+    rows.reserve(items.size());
+    foreach (const QVariant &value, items) {
+        item = value.toMap();
+        parseData(&item);
+        rows << item;
+    }
+
+    // forward the progress only for this component table
+    QMetaObject::Connection connection = connect(m_database, &Database::batchProgress, this, [this](const QString &tableName, int processed, int total) {
+        if (tableName == m_tableName)
+            emit insertProgress(processed, total);
+    });
+    QVariantMap result(m_database->upsertBatch(m_tableName, rows, QStringList(m_pkColumn.isEmpty() ? QStringLiteral("id") : m_pkColumn)));
+    disconnect(connection);
+
+    // the upsert does not tell if the rows was inserted or updated, so count again
+    m_totalItens = m_database->count(m_tableName);
+    return result;
+}
+
 void DatabaseComponent::select(const QVariantMap &where, const QVariantMap &args)
 {
-    // make a asynchronous selection in database, using another thread created by Private::AsyncSelect
-    auto *worker = new AsyncSelect(m_tableName, m_jsonColumns, where, args, this);
+    // the new selection supersede the previous selections of this component
+    cancel();
+
+    // the rows are cached with the decoded json columns, so the json columns are part of the key
+    QStringList jsonColumns(args.contains(QStringLiteral("jsonColumns")) ? args.value(QStringLiteral("jsonColumns")).toStringList() : m_jsonColumns);
+    QString cacheKey(m_database->resultCacheKey(m_tableName, where, args, QStringLiteral("async:") + jsonColumns.join(QStringLiteral(","))));
+    ResultCache::Entry entry;
+    if (!cacheKey.isEmpty() && m_database->resultCache()->find(cacheKey, &entry)) {
+        // a cache hit is sent in this thread, without execute the query in the thread pool
+        QElapsedTimer timer;
+        timer.start();
+        int total = entry.items.size();
+        int chunkSize = qMax(1, m_chunkSize);
+        for (int i = 0; i < total; i += chunkSize)
+            emit itemsLoaded(entry.items.mid(i, chunkSize));
+        if (args.contains(QStringLiteral("after")) || args.contains(QStringLiteral("before")))
+            emit pageLoaded(entry.previous, entry.next);
+        emit finished(total, timer.elapsed());
+        return;
+    }
+
+    // make a asynchronous selection in database, executed by some thread of the QueryExecutor pool
+    auto *worker = new AsyncSelect(m_tableName, m_jsonColumns, where, args, m_chunkSize);
+    worker->setCacheKey(cacheKey);
+    m_workers << worker;
+
+    // after the worker run finish, delete the worker pointer
+    connect(worker, &AsyncSelect::runFinished, worker, &QObject::deleteLater);
+    connect(worker, &AsyncSelect::runFinished, this, [this, worker]() {
+        m_workers.removeOne(worker);
+    });
+
+    // for each chunk of rows loaded by the worker thread, we needs to emit the itemsLoaded signal to QML object
+    connect(worker, &AsyncSelect::itemsLoaded, this, &DatabaseComponent::itemsLoaded);
+    connect(worker, &AsyncSelect::pageLoaded, this, &DatabaseComponent::pageLoaded);
+    connect(worker, &AsyncSelect::selectFinished, this, &DatabaseComponent::finished);
+
+    // put the worker in the thread pool queue, internally call the 'run' method, where is the selection in database
+    QueryExecutor::instance()->start(worker, m_priority);
+}
+
+void DatabaseComponent::search(const QString &text, int limit, const QVariantMap &where)
+{
+    QVariantMap args;
+    if (limit > 0)
+        args.insert(QStringLiteral("limit"), limit);
+    // a empty text load the table rows again, like when the user cancel the search
+    if (!text.trimmed().isEmpty())
+        args.insert(QStringLiteral("search"), text);
+    select(where, args);
+}
+
+int DatabaseComponent::count(const QVariantMap &where, const QVariantMap &args)
+{
+    if (m_tableName.isEmpty())
+        return 0;
+    return m_database->count(m_tableName, where, args);
+}
 
-    // after thread finished, delete the worker pointer
-    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+void DatabaseComponent::selectModel(const QVariantMap &where, const QVariantMap &args)
+{
+    QVariantMap modelArgs(args);
+    if (!modelArgs.contains(QStringLiteral("pkColumn")) && !m_pkColumn.isEmpty())
+        modelArgs.insert(QStringLiteral("pkColumn"), m_pkColumn);
+    m_model->select(where, modelArgs);
+}
 
-    // after worker thread load all result, we needs to emit the itemLoaded signal to QML object
-    connect(worker, &AsyncSelect::itemLoaded, this, &DatabaseComponent::itemLoaded);
+TableModel *DatabaseComponent::model() const
+{
+    return m_model;
+}
 
-    // start thread execution, internally call the 'run' method, where is the selection in database
-    worker->start();
+void DatabaseComponent::cancel()
+{
+    QueryExecutor *queryExecutor = QueryExecutor::instance();
+    foreach (AsyncSelect *worker, m_workers) {
+        // the chunks already sent by the worker are ignored
+        disconnect(worker, nullptr, this, nullptr);
+        if (queryExecutor->cancel(worker)) {
+            // the worker was removed from the queue before start and never will be run
+            delete worker;
+        } else {
+            // the worker is running, and will be deleted after the run finish
+            worker->cancel();
+        }
+    }
+    m_workers.clear();
 }
 
 int DatabaseComponent::update(const QVariantMap &data, const QVariantMap &where)
@@ -131,9 +307,122 @@ int DatabaseComponent::update(const QVariantMap &data, const QVariantMap &where)
     return 0;
 }
 
-int DatabaseComponent::remove(const QVariantMap &where)
+int DatabaseComponent::remove(const QVariantMap &where, const QVariantMap &args)
 {
     if (m_tableName.isEmpty() || !where.size())
         return 0;
-   return m_database->remove(m_tableName, where);
+    int removed = m_database->removeWhere(m_tableName, where, args);
+    m_totalItens -= qMin(removed, m_totalItens);
+    return removed;
+}
+
+QVariantMap DatabaseComponent::removeIds(const QVariantList &ids)
+{
+    if (m_tableName.isEmpty())
+        return QVariantMap();
+    QVariantMap result(m_database->removeIds(m_tableName, ids, m_pkColumn.isEmpty() ? QStringLiteral("id") : m_pkColumn));
+    int removed = result.value(QStringLiteral("removed")).toInt();
+    m_totalItens -= qMin(removed, m_totalItens);
+    return result;
+}
+
+int DatabaseComponent::insertAsync(const QVariantMap &data, const QJSValue &callback)
+{
+    return enqueueWrite(WriteQueue::Insert, data, QVariantMap(), callback);
+}
+
+int DatabaseComponent::updateAsync(const QVariantMap &data, const QVariantMap &where, const QJSValue &callback)
+{
+    return enqueueWrite(WriteQueue::Update, data, where, callback);
+}
+
+int DatabaseComponent::upsertAsync(const QVariantMap &data, const QJSValue &callback)
+{
+    return enqueueWrite(WriteQueue::Upsert, data, QVariantMap(), callback);
+}
+
+int DatabaseComponent::removeAsync(const QVariantMap &where, const QJSValue &callback)
+{
+    if (!where.size())
+        return 0;
+    return enqueueWrite(WriteQueue::Remove, QVariantMap(), where, callback);
+}
+
+QVariantMap DatabaseComponent::profilerReport() const
+{
+    return m_database->profilerReport();
+}
+
+bool DatabaseComponent::dumpProfilerReport(const QString &filePath)
+{
+    return m_database->dumpProfilerReport(filePath);
+}
+
+QVariantMap DatabaseComponent::storageBenchmark(const QString &column, int rows)
+{
+    if (m_tableName.isEmpty())
+        return QVariantMap();
+    return m_database->storageBenchmark(m_tableName, column, rows);
+}
+
+QVariantMap DatabaseComponent::maintenanceStats() const
+{
+    return DatabaseMaintenance::instance()->stats();
+}
+
+int DatabaseComponent::importJson(const QUrl &url, const QVariantMap &options)
+{
+    if (m_tableName.isEmpty())
+        return 0;
+
+    QVariantMap importOptions(options);
+    if (!importOptions.contains(QStringLiteral("conflictColumns")) && !m_pkColumn.isEmpty())
+        importOptions.insert(QStringLiteral("conflictColumns"), QStringList() << m_pkColumn);
+
+    int importId = m_database->importJson(m_tableName, url, importOptions);
+    m_imports.insert(importId);
+    return importId;
+}
+
+void DatabaseComponent::cancelImport(int importId)
+{
+    if (m_imports.contains(importId))
+        m_database->cancelImport(importId);
+}
+
+int DatabaseComponent::enqueueWrite(int operation, const QVariantMap &data, const QVariantMap &where, const QJSValue &callback)
+{
+    if (m_tableName.isEmpty())
+        return 0;
+
+    WriteQueue::Write write;
+    write.operation = static_cast<WriteQueue::Operation>(operation);
+    write.tableName = m_tableName;
+    write.data = data;
+    write.where = where;
+    if (write.operation == WriteQueue::Upsert)
+        write.conflictColumns << (m_pkColumn.isEmpty() ? QStringLiteral("id") : m_pkColumn);
+    // the json columns are serialized here, because parseData reads the members of this object
+    if (!write.data.isEmpty())
+        parseData(&write.data);
+
+    int writeId = WriteQueue::instance()->enqueue(write);
+    m_pendingWrites.insert(writeId, callback);
+    return writeId;
+}
+
+void DatabaseComponent::onWriteFinished(int writeId, const QString &operation, int result)
+{
+    // the write was queued by another component
+    if (!m_pendingWrites.contains(writeId))
+        return;
+
+    QJSValue callback(m_pendingWrites.take(writeId));
+    if (operation == QStringLiteral("insert") && result)
+        ++m_totalItens;
+    else if (operation == QStringLiteral("remove"))
+        m_totalItens -= qMin(result, m_totalItens);
+    if (callback.isCallable())
+        callback.call(QJSValueList() << result);
+    emit writeFinished(writeId, operation, result);
 }
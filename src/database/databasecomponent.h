@@ -1,9 +1,15 @@
 #ifndef DATABASECOMPONENT_H
 #define DATABASECOMPONENT_H
 
+#include <QHash>
+#include <QJSValue>
 #include <QObject>
+#include <QSet>
+#include <QUrl>
 #include <QVariant>
 
+#include "tablemodel.h"
+
 class Database;
 class AsyncSelect;
 
@@ -32,14 +38,36 @@ class AsyncSelect;
  *    Database {
  *       id: database
  *       jsonColumns: ["sender"] 
- *       onItemLoaded: listViewModel.append(data)
+ *       onItemsLoaded: listViewModel.append(items)
  *    }
  * }
  * 
- * To select uses: select("plugin_table", {"id": 1}). The result wil be sent in itemLoaded signal with a QVariantList of QVariantMap's.
+ * To show large tables in a ListView, uses the 'model' property (a TableModel with one role for each column)
+ * and selectModel({"id": 1}). The rows are read from database only when the ListView needs to show it.
+ * To select only some columns or aggregates, uses the args: select({}, {"columns": ["id", "name"]}) or
+ * select({}, {"groupBy": "category", "count": "*"}). To count the rows uses: count({"category": 1}).
+ * The json columns can be filtered and selected by path, without decode the documents: select({"sender.city": "Rio"},
+ * {"columns": ["id", "sender.name"]}) send the maps with "id" and "sender_name". The "jsonColumns" argument limits the
+ * json columns decoded to object or array in the selection, like select({}, {"jsonColumns": ["sender"]}).
+ * The columns declared in plugin config.json as "cborColumns": {"plugin_table": ["payload"]} are saved as CBOR blobs
+ * and decoded straight to object or array (see Database::setCborColumns). To compare the formats with the saved rows,
+ * uses storageBenchmark("payload").
+ * To select uses: select("plugin_table", {"id": 1}). The result wil be sent in itemsLoaded signal with a QVariantList of QVariantMap's,
+ * in chunks of 'chunkSize' items. After all items are sent, the finished signal is emitted.
+ * To paginate uses keyset pagination: select({}, {"limit": 50, "after": ""}) and on pageLoaded(previous, next)
+ * call select({}, {"limit": 50, "after": next}). The cost of each page does not grow with the page number like "offset".
  * To insert uses: insert("plugin_table", {"name": "Mouse Logitech MA1x", "price": 19,55})
  * To update uses: update("plugin_table", {"price": 21,15}, {"name": "Mouse Logitech MA1x"})
- * To remove uses: remove("plugin_table", {"name": "Mouse Logitech MA1x"})
+ * To remove uses: remove("plugin_table", {"name": "Mouse Logitech MA1x"}) or, for a list of primary keys, removeIds([1, 2, 3]).
+ * To search uses: search("mouse log", 50). The table needs a search index, declared in plugin config.json as
+ * "searchColumns": {"plugin_table": ["name", "description"]}, and the rows are sent in itemsLoaded ordered by relevance.
+ * To not block the GUI thread, uses the async methods: insertAsync, updateAsync, upsertAsync and removeAsync.
+ * The writes are executed by the WriteQueue thread and the result is sent to the callback (if set) and in the writeFinished signal:
+ *   database.insertAsync({"name": "Mouse"}, function(insertId) { console.log(insertId) })
+ * The static data shipped by a plugin as 'seed.db' is attached read-only under the plugin name, and can be read setting
+ * the tableName with the schema, like "catalog.products" (see Database::attachSeedDatabase).
+ * To import a large json array or NDJSON file (local or http) uses: importJson("https://host/products.ndjson", {"batchSize": 1000}).
+ * The file is parsed and saved by a JsonImporter thread in batches, and the importProgress and importFinished signals are emitted.
  */
 class DatabaseComponent : public QObject
 {
@@ -48,6 +76,9 @@ class DatabaseComponent : public QObject
     Q_PROPERTY(QString tableName MEMBER m_tableName WRITE setTableName)
     Q_PROPERTY(QString pkColumn MEMBER m_pkColumn WRITE setPkColumn)
     Q_PROPERTY(QStringList jsonColumns MEMBER m_jsonColumns WRITE setJsonColumns)
+    Q_PROPERTY(int chunkSize MEMBER m_chunkSize)
+    Q_PROPERTY(int priority MEMBER m_priority)
+    Q_PROPERTY(TableModel *model READ model CONSTANT FINAL)
 public:
     /**
      * @brief DatabaseComponent
@@ -55,10 +86,17 @@ public:
      */
     explicit DatabaseComponent(QObject *parent = nullptr);
 
+    /**
+     * @brief ~DatabaseComponent
+     * The object destructor. Cancel the pending and running selections, because
+     * the component can be destroyed (when the page is popped) while some AsyncSelect is running.
+     */
+    ~DatabaseComponent();
+
     /**
      * @brief containsId
-     * Check if the item parameter exists in m_savedPks property.
-     * The item can be the table primary key, to check if already exists on database
+     * Check if the item parameter exists in the table primary key column ('pkColumn' or "id").
+     * The check is a indexed query in database, so it works for any table size.
      * @param item QVariant the item to check if already exists on database. The value can be a integer or string
      * @return bool
      */
@@ -66,18 +104,98 @@ public:
 
     /**
      * @brief insert
+     * Insert the data in the table using 'ON CONFLICT(pk) DO NOTHING', so the data with a primary key
+     * already saved in database is not inserted again. The data that fails other constraints is not inserted and the error is logged.
      * @param data
-     * @return int id of inserted row
+     * @return int id of inserted row or zero if the row was not inserted
      */
     Q_INVOKABLE int insert(const QVariantMap &data);
 
+    /**
+     * @brief insertBatch
+     * Insert a list of items in a single transaction, reusing the same prepared statement for all rows.
+     * Items with a primary key (or a unique column) already saved in database are ignored by sqlite.
+     * While the rows are inserted, the insertProgress signal is emitted.
+     * @param items QVariantList a list of objects (javascript objects) with column_name->value
+     * @return QVariantMap a map with "inserted" (integer), "ignored" (integer), "failed" (integer) and "ids" (the list of inserted ids)
+     */
+    Q_INVOKABLE QVariantMap insertBatch(const QVariantList &items);
+
+    /**
+     * @brief upsert
+     * Insert the data in the table or, if the primary key ('pkColumn' or "id") already exists, update the saved row.
+     * It's a single statement, so the sync code does not needs to call containsId before insert or update.
+     * @param data QVariantMap a object (javascript object) with column_name->value
+     * @return int the number of inserted or updated rows
+     */
+    Q_INVOKABLE int upsert(const QVariantMap &data);
+
+    /**
+     * @brief upsertBatch
+     * Execute upsert for each item in a single transaction, reusing the same prepared statement for all rows.
+     * While the rows are saved, the insertProgress signal is emitted.
+     * @param items QVariantList a list of objects (javascript objects) with column_name->value
+     * @return QVariantMap a map with "affected" (integer) and "failed" (integer)
+     */
+    Q_INVOKABLE QVariantMap upsertBatch(const QVariantList &items);
+
     /**
      * @brief select
+     * Start a asynchronous selection in the QueryExecutor thread pool, using the component 'priority'.
+     * A new selection supersede the previous selections from this component: the pending or running selections are canceled.
+     * If the same selection is in the Database result cache (the table was not changed after the last execution),
+     * the itemsLoaded and finished signals are emitted before return, without execute the query.
      * @param where QVariantMap
      * @param args QVariantMap
      */
     Q_INVOKABLE void select(const QVariantMap &where, const QVariantMap &args = QVariantMap());
 
+    /**
+     * @brief search
+     * Start a asynchronous full text search in the table searchable columns (the "searchColumns" from plugin config.json),
+     * like select(...): the rows are sent in itemsLoaded signal, ordered by relevance, and the previous selection is canceled.
+     * Each row has the "snippet" (the matched text with the words between <b> and </b>) and the "rank" properties.
+     * If 'text' is empty, the first 'limit' rows of the table are selected.
+     * The matched rows are filtered by 'where', with each column compared by '='.
+     * @param text QString the text typed by the user
+     * @param limit int the max number of rows. Default is 50
+     * @param where QVariantMap the column_name -> value used to filter the rows
+     */
+    Q_INVOKABLE void search(const QString &text, int limit = 50, const QVariantMap &where = QVariantMap());
+
+    /**
+     * @brief count
+     * Return the number of rows of the table filtered by 'where', using 'SELECT count(*)'.
+     * Only the number is read from database, not the rows.
+     * @param where QVariantMap
+     * @param args QVariantMap the select arguments, like "whereComparator"
+     * @return int
+     */
+    Q_INVOKABLE int count(const QVariantMap &where = QVariantMap(), const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief cancel
+     * Stop all running selections started by select(...).
+     * After canceled, the itemsLoaded and finished signals are not emitted for these selections.
+     */
+    Q_INVOKABLE void cancel();
+
+    /**
+     * @brief selectModel
+     * Select the table rows using the where and args (the same of select method) to be read on demand by the 'model' property,
+     * in pages of 'fetchSize' rows ordered by the primary key (pkColumn). The model is reset and the ListView load the pages when needs to show it.
+     * @param where QVariantMap
+     * @param args QVariantMap
+     */
+    Q_INVOKABLE void selectModel(const QVariantMap &where = QVariantMap(), const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief model
+     * Return the list model of the current table, to be used as ListView model
+     * @return TableModel*
+     */
+    TableModel *model() const;
+
     /**
      * @brief update
      * @param data QVariantMap
@@ -90,15 +208,114 @@ public:
      * @brief remove
      * Remove a entries of the table using the where map as filter condition,
      * the where needs to contains the column_name->value to be compared in database.
+     * A list value is compared with IN, like remove({"id": [1, 2, 3]}), and the args
+     * accepts "whereOperator" and "whereComparator", like remove({"expires_at": now}, {"whereComparator": "<"})
+     * (see Database::removeWhere).
      * @param where QVariantMap
+     * @param args QVariantMap
      * @return int the total number of deleted rows
      */
-    Q_INVOKABLE int remove(const QVariantMap &where);
+    Q_INVOKABLE int remove(const QVariantMap &where, const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief removeIds
+     * Remove the entries with the primary key (pkColumn or "id") in the 'ids' list, in chunks and in a single transaction.
+     * @param ids QVariantList
+     * @return QVariantMap a map with the "removed" and "failed" counts (see Database::removeIds)
+     */
+    Q_INVOKABLE QVariantMap removeIds(const QVariantList &ids);
+
+    /**
+     * @brief insertAsync
+     * Put the insert in the WriteQueue and return immediately. The row is inserted by the writer thread,
+     * grouped in a transaction with the others queued writes. Like insert, the existing primary keys are ignored.
+     * @param data QVariantMap a object (javascript object) with column_name->value
+     * @param callback QJSValue a optional javascript function called with the insert id (or zero)
+     * @return int the write id, sent in the writeFinished signal
+     */
+    Q_INVOKABLE int insertAsync(const QVariantMap &data, const QJSValue &callback = QJSValue());
+
+    /**
+     * @brief updateAsync
+     * Put the update in the WriteQueue and return immediately.
+     * @param data QVariantMap
+     * @param where QVariantMap
+     * @param callback QJSValue a optional javascript function called with the number of updated rows
+     * @return int the write id, sent in the writeFinished signal
+     */
+    Q_INVOKABLE int updateAsync(const QVariantMap &data, const QVariantMap &where, const QJSValue &callback = QJSValue());
+
+    /**
+     * @brief upsertAsync
+     * Put the upsert in the WriteQueue and return immediately.
+     * @param data QVariantMap a object (javascript object) with column_name->value
+     * @param callback QJSValue a optional javascript function called with the number of inserted or updated rows
+     * @return int the write id, sent in the writeFinished signal
+     */
+    Q_INVOKABLE int upsertAsync(const QVariantMap &data, const QJSValue &callback = QJSValue());
+
+    /**
+     * @brief removeAsync
+     * Put the remove in the WriteQueue and return immediately.
+     * @param where QVariantMap
+     * @param callback QJSValue a optional javascript function called with the number of deleted rows
+     * @return int the write id, sent in the writeFinished signal, or zero if the where is empty
+     */
+    Q_INVOKABLE int removeAsync(const QVariantMap &where, const QJSValue &callback = QJSValue());
+
+    /**
+     * @brief profilerReport
+     * Return the query profiler statistics of all database statements, with the time histogram, rows
+     * and the query plan of the slow statements. Useful to find the tables that needs indexes.
+     * @return QVariantMap see QueryProfiler::report()
+     */
+    Q_INVOKABLE QVariantMap profilerReport() const;
+
+    /**
+     * @brief dumpProfilerReport
+     * Save the query profiler statistics as json in 'filePath'
+     * @param filePath QString
+     * @return bool
+     */
+    Q_INVOKABLE bool dumpProfilerReport(const QString &filePath);
+
+    /**
+     * @brief storageBenchmark
+     * Compare the size, encode and decode time of the json and CBOR formats with the values of 'column' (see Database::storageBenchmark)
+     * @param column QString a json or CBOR column of the table
+     * @param rows int the max number of rows to read
+     * @return QVariantMap
+     */
+    Q_INVOKABLE QVariantMap storageBenchmark(const QString &column, int rows = 1000);
+
+    /**
+     * @brief maintenanceStats
+     * Return the database file size, free pages and the statistics of the last maintenance run (see DatabaseMaintenance::maintenanceFinished)
+     * @return QVariantMap
+     */
+    Q_INVOKABLE QVariantMap maintenanceStats() const;
+
+    /**
+     * @brief importJson
+     * Import a json array or NDJSON from 'url' into the table, without load the full file in memory (see Database::importJson).
+     * @param url QUrl a local file, resource or http(s) url
+     * @param options QVariantMap the import options, like "batchSize", "fields" and "mode"
+     * @return int the import id, or zero if the table name is not set
+     */
+    Q_INVOKABLE int importJson(const QUrl &url, const QVariantMap &options = QVariantMap());
+
+    /**
+     * @brief cancelImport
+     * Stop the import with 'importId'. The rows already committed are kept.
+     * @param importId int
+     */
+    Q_INVOKABLE void cancelImport(int importId);
 
 private:
     /**
      * @brief load
-     * Load table columns and the total itens saved in database for current plugin
+     * Load table columns and the total itens saved in database for current plugin.
+     * Is called after set the table name, or after the Database::schemaReady signal if the migrations are running.
      */
     void load();
 
@@ -130,18 +347,101 @@ private:
      * @brief parseData
      * This method parse a object or array to be saved as string serialized in database.
      * Basically, iterate in 'm_jsonColumns' parsing json object or array found in &insertData using QJsonDocument.
+     * The values of the 'm_cborColumns' are encoded as CBOR blobs instead of json strings.
      * Uses QMetaType to check each column value type.
      * @param insertData QVariantMap*
      */
     void parseData(QVariantMap *data);
 
+    /**
+     * @brief enqueueWrite
+     * Put the write in the WriteQueue and keep the callback to be called when the write finish.
+     * @param operation int a WriteQueue::Operation value
+     * @param data QVariantMap
+     * @param where QVariantMap
+     * @param callback QJSValue
+     * @return int the write id
+     */
+    int enqueueWrite(int operation, const QVariantMap &data, const QVariantMap &where, const QJSValue &callback);
+
+    /**
+     * @brief onWriteFinished
+     * Handle the WriteQueue::writeFinished signal: if the write was queued by this object,
+     * update the totalItens, call the write callback and emit the writeFinished signal.
+     * @param writeId int
+     * @param operation QString
+     * @param result int
+     */
+    void onWriteFinished(int writeId, const QString &operation, int result);
+
 signals:
     /**
-     * @brief itemLoaded
-     * This signal will be emitted after load some database data in select method.
-     * @param data QVariantMap a map with column_name->value loaded from database.
+     * @brief itemsLoaded
+     * This signal will be emitted for each chunk of 'chunkSize' items loaded from database in select method.
+     * @param items QVariantList a list of QVariantMap with column_name->value loaded from database.
+     */
+    void itemsLoaded(const QVariantList &items);
+
+    /**
+     * @brief finished
+     * This signal will be emitted after the select method send all items loaded from database.
+     * @param total int the total of items loaded
+     * @param elapsedMs qint64 the time spent in the selection in milliseconds
+     */
+    void finished(int total, qint64 elapsedMs);
+
+    /**
+     * @brief pageLoaded
+     * This signal will be emitted before the finished signal when select uses keyset pagination.
+     * To load the next page, call select(where, {"limit": n, "after": next}).
+     * To load the previous page, call select(where, {"limit": n, "before": previous}).
+     * @param previous QString the token to load the previous page, or a empty string if is the first page
+     * @param next QString the token to load the next page, or a empty string if is the last page
+     */
+    void pageLoaded(const QString &previous, const QString &next);
+
+    /**
+     * @brief insertProgress
+     * This signal will be emitted while insertBatch or upsertBatch save the items in database.
+     * @param processed int the number of items already processed
+     * @param total int the total number of items to insert
+     */
+    void insertProgress(int processed, int total);
+
+    /**
+     * @brief writeFinished
+     * This signal will be emitted after a async write (insertAsync, updateAsync, upsertAsync or removeAsync) is committed.
+     * @param writeId int the id returned by the async method
+     * @param operation QString the operation name: "insert", "update", "upsert" or "remove"
+     * @param result int the insert id (for insert) or the number of affected rows. Zero if the write fails.
+     */
+    void writeFinished(int writeId, const QString &operation, int result);
+
+    /**
+     * @brief tableChanged
+     * This signal will be emitted after the rows of the component table are changed by any component or thread.
+     * Can be used to update only the changed items in the view, without select all rows again.
+     * @param changes QVariantList the list of changes (see Database::tableChanged)
+     */
+    void tableChanged(const QVariantList &changes);
+
+    /**
+     * @brief importProgress
+     * This signal will be emitted after each batch of rows saved by importJson.
+     * @param importId int the id returned by importJson
+     * @param rows int the number of json objects read
+     * @param bytes qint64 the number of bytes read
+     * @param totalBytes qint64 the file size, or -1 if unknown
+     */
+    void importProgress(int importId, int rows, qint64 bytes, qint64 totalBytes);
+
+    /**
+     * @brief importFinished
+     * This signal will be emitted at the end of the importJson.
+     * @param importId int the id returned by importJson
+     * @param result QVariantMap a map with "rows", "inserted", "ignored", "failed", "bytes", "canceled" and "error"
      */
-    void itemLoaded(const QVariantMap &entry);
+    void importFinished(int importId, const QVariantMap &result);
 
 private:
     /**
@@ -151,18 +451,12 @@ private:
      */
     int m_totalItens;
 
-    /**
-     * @brief m_savedPks
-     * A QVariantList with all ID's saved in database for current table.
-     * It's useful to check if the current table contains a some item and prevent to insert again.
-     */
-    QVariantList m_savedPks;
-
     /**
      * @brief m_pkColumn
      * Set a column name when the tables uses a string column as
-     * primary key. If defined, will be used to retrieve and keept in m_savedPks
+     * primary key. If defined, will be used by containsId
      * and ca be useful to qml plugins check if some item from webservice is already on database.
+     * The column needs to be the table PRIMARY KEY (or UNIQUE) to the inserts ignore the existing rows.
      */
     QString m_pkColumn;
 
@@ -194,6 +488,55 @@ private:
      * m_jsonColumns is used to parse these strings to QVariant(Map/List) before return to QML objects.
      */
     QStringList m_jsonColumns;
+
+    /**
+     * @brief m_cborColumns
+     * The columns of the table saved as CBOR, loaded from Database::cborColumns when the table is set.
+     */
+    QStringList m_cborColumns;
+
+    /**
+     * @brief m_chunkSize
+     * The number of items sent in each itemsLoaded signal. The default is 200.
+     */
+    int m_chunkSize;
+
+    /**
+     * @brief m_workers
+     * Keeps the running AsyncSelect workers, to be canceled by cancel() or when this object is destroyed.
+     */
+    QList<AsyncSelect*> m_workers;
+
+    /**
+     * @brief m_priority
+     * The priority of the selections from this component in the QueryExecutor queue.
+     * Pages visible to the user can set a greater priority to load your items first. The default is 0 (zero).
+     */
+    int m_priority;
+
+    /**
+     * @brief m_model
+     * The list model of the current table, loaded by selectModel
+     */
+    TableModel *m_model;
+
+    /**
+     * @brief m_schemaReadyConnection
+     * The connection with Database::schemaReady, used to call load() after the migrations finish
+     */
+    QMetaObject::Connection m_schemaReadyConnection;
+
+    /**
+     * @brief m_pendingWrites
+     * The async writes queued by this object, as write id -> callback (can be a undefined QJSValue)
+     */
+    QHash<int, QJSValue> m_pendingWrites;
+
+    /**
+     * @brief m_imports
+     * The running imports started by this object
+     */
+    QSet<int> m_imports;
 };
 
 #endif // DATABASECOMPONENT_H
@@ -0,0 +1,230 @@
+#include "databasemaintenance.h"
+#include "database.h"
+#include "../core/utils.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QMutexLocker>
+#include <QTimer>
+
+DatabaseMaintenance* DatabaseMaintenance::m_instance = nullptr;
+
+DatabaseMaintenance::DatabaseMaintenance(QObject *parent) : QThread(parent)
+  ,m_database(Database::instance())
+  ,m_idleTimer(new QTimer(this))
+  ,m_interval(3600000)
+  ,m_budget(250)
+  ,m_vacuumPages(128)
+  ,m_vacuumRatio(0.25)
+  ,m_backgroundBudget(5000)
+  ,m_convertAutoVacuum(true)
+  ,m_lastRun(0)
+  ,m_hasChanges(1)
+  ,m_stopRequested(0)
+{
+    m_database->addDedicatedThread(this);
+
+    int idleInterval = 30000;
+    QVariantMap config(Utils::instance()->readFile(QStringLiteral(":/config.json")).toMap().value(QStringLiteral("database")).toMap());
+    if (config.contains(QStringLiteral("maintenance_idle_ms")))
+        idleInterval = config.value(QStringLiteral("maintenance_idle_ms")).toInt();
+    if (config.value(QStringLiteral("maintenance_interval_ms")).toLongLong() > 0)
+        m_interval = config.value(QStringLiteral("maintenance_interval_ms")).toLongLong();
+    if (config.value(QStringLiteral("maintenance_budget_ms")).toLongLong() > 0)
+        m_budget = config.value(QStringLiteral("maintenance_budget_ms")).toLongLong();
+    if (config.value(QStringLiteral("maintenance_vacuum_pages")).toInt() > 0)
+        m_vacuumPages = config.value(QStringLiteral("maintenance_vacuum_pages")).toInt();
+    if (config.value(QStringLiteral("maintenance_vacuum_ratio")).toDouble() > 0)
+        m_vacuumRatio = config.value(QStringLiteral("maintenance_vacuum_ratio")).toDouble();
+    if (config.value(QStringLiteral("maintenance_background_budget_ms")).toLongLong() > 0)
+        m_backgroundBudget = config.value(QStringLiteral("maintenance_background_budget_ms")).toLongLong();
+    if (config.contains(QStringLiteral("auto_vacuum")))
+        m_convertAutoVacuum = config.value(QStringLiteral("auto_vacuum")).toString().compare(QStringLiteral("INCREMENTAL"), Qt::CaseInsensitive) == 0;
+
+    // the idle timer is restarted by each change, so the maintenance never competes with a sequence of writes.
+    // A zero "maintenance_idle_ms" disable the idle runs, keeping only the background runs
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(idleInterval);
+    connect(m_idleTimer, &QTimer::timeout, this, [this]() { requestRun(); });
+    connect(m_database, &Database::tableChanged, this, [this, idleInterval]() {
+        m_hasChanges.store(1);
+        if (idleInterval > 0)
+            m_idleTimer->start();
+    }, Qt::QueuedConnection);
+
+    QGuiApplication *application = qobject_cast<QGuiApplication*>(QCoreApplication::instance());
+    if (application) {
+        connect(application, &QGuiApplication::applicationStateChanged, this, [this](Qt::ApplicationState state) {
+            onApplicationStateChanged(state);
+        });
+        connect(application, &QCoreApplication::aboutToQuit, this, &DatabaseMaintenance::stop, Qt::DirectConnection);
+    }
+}
+
+DatabaseMaintenance *DatabaseMaintenance::instance()
+{
+    if (!DatabaseMaintenance::m_instance)
+        DatabaseMaintenance::m_instance = new DatabaseMaintenance;
+    return DatabaseMaintenance::m_instance;
+}
+
+bool DatabaseMaintenance::requestRun(bool ignoreInterval)
+{
+    if (isRunning() || m_hasChanges.load() == 0)
+        return false;
+    if (!ignoreInterval && m_lastRun > 0 && QDateTime::currentMSecsSinceEpoch() - m_lastRun < m_interval)
+        return false;
+
+    // the application state is read in the GUI thread, and the run uses it to allow the full VACUUM
+    Qt::ApplicationState state = qobject_cast<QGuiApplication*>(QCoreApplication::instance()) ? QGuiApplication::applicationState() : Qt::ApplicationActive;
+    m_isBackground.store(state == Qt::ApplicationHidden || state == Qt::ApplicationSuspended ? 1 : 0);
+    m_hasChanges.store(0);
+    m_stopRequested.store(0);
+    m_lastRun = QDateTime::currentMSecsSinceEpoch();
+    start(QThread::LowPriority);
+    return true;
+}
+
+void DatabaseMaintenance::stop()
+{
+    m_idleTimer->stop();
+    m_stopRequested.store(1);
+    wait();
+}
+
+QVariantMap DatabaseMaintenance::stats()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_stats.isEmpty())
+        return m_stats;
+    locker.unlock();
+    return fileStats();
+}
+
+void DatabaseMaintenance::onApplicationStateChanged(int state)
+{
+    // the user is not using the application, so the maintenance does not compete with the GUI queries
+    if (state == Qt::ApplicationHidden || state == Qt::ApplicationSuspended)
+        requestRun(true);
+}
+
+QVariant DatabaseMaintenance::pragmaValue(const QString &name)
+{
+    if (!m_database->queryExec(QStringLiteral("PRAGMA ") + name))
+        return QVariant();
+    QVariantList rows(m_database->resultSet());
+    if (rows.isEmpty())
+        return QVariant();
+    QVariantMap row(rows.first().toMap());
+    return row.isEmpty() ? QVariant() : row.first();
+}
+
+QVariantMap DatabaseMaintenance::fileStats()
+{
+    QVariantMap stats;
+    QString fileName(m_database->fileName());
+    stats.insert(QStringLiteral("fileSize"), QFileInfo(fileName).size());
+    stats.insert(QStringLiteral("walSize"), QFileInfo(fileName + QStringLiteral("-wal")).size());
+    stats.insert(QStringLiteral("pageSize"), pragmaValue(QStringLiteral("page_size")).toInt());
+    stats.insert(QStringLiteral("pageCount"), pragmaValue(QStringLiteral("page_count")).toInt());
+    stats.insert(QStringLiteral("freelistCount"), pragmaValue(QStringLiteral("freelist_count")).toInt());
+    stats.insert(QStringLiteral("autoVacuum"), pragmaValue(QStringLiteral("auto_vacuum")).toInt());
+    return stats;
+}
+
+void DatabaseMaintenance::run()
+{
+    QElapsedTimer timer;
+    QElapsedTimer stepTimer;
+    timer.start();
+
+    bool budgetExceeded = false;
+    QVariantMap stats;
+    m_database->openConnection();
+
+    // optimize runs ANALYZE only in the tables with stale statistics, and the analysis_limit
+    // (ignored by sqlite older than 3.32) limits the rows read by each ANALYZE
+    stepTimer.start();
+    m_database->queryExec(QStringLiteral("PRAGMA analysis_limit = 400"));
+    m_database->queryExec(QStringLiteral("PRAGMA optimize"));
+    stats.insert(QStringLiteral("optimizeMs"), stepTimer.elapsed());
+
+    // the files created before the INCREMENTAL default keep auto_vacuum NONE, and only a full VACUUM changes the mode.
+    // The VACUUM rewrites the file and cannot be interrupted, so it runs only in background, when the free pages
+    // are worth it and the time estimated for a conservative 10 MB/s copy of the used pages fits the background budget
+    int freelistCount = 0;
+    bool autoVacuumConverted = false;
+    stepTimer.restart();
+    int autoVacuum = pragmaValue(QStringLiteral("auto_vacuum")).toInt();
+    if (autoVacuum != 2 && m_convertAutoVacuum && m_isBackground.load() && !m_stopRequested.load()) {
+        int pageCount = pragmaValue(QStringLiteral("page_count")).toInt();
+        freelistCount = pragmaValue(QStringLiteral("freelist_count")).toInt();
+        qint64 usedBytes = static_cast<qint64>(pageCount - freelistCount) * pragmaValue(QStringLiteral("page_size")).toInt();
+        if (pageCount > 0 && freelistCount >= pageCount * m_vacuumRatio) {
+            if (timer.elapsed() + usedBytes / 10000 > m_backgroundBudget) {
+                budgetExceeded = true;
+            } else {
+                autoVacuumConverted = m_database->queryExec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL")) && m_database->queryExec(QStringLiteral("VACUUM"));
+                if (!autoVacuumConverted)
+                    emit m_database->logMessage(QStringLiteral("Fatal error on try convert the database to auto_vacuum INCREMENTAL: ") + m_database->lastError());
+                autoVacuum = pragmaValue(QStringLiteral("auto_vacuum")).toInt();
+            }
+        }
+    }
+    stats.insert(QStringLiteral("autoVacuumConverted"), autoVacuumConverted);
+    stats.insert(QStringLiteral("convertMs"), stepTimer.elapsed());
+
+    // each incremental_vacuum step returns at most m_vacuumPages free pages to the file system.
+    // The pragma frees one page for each result row, so the result set is read until the end
+    int vacuumPages = 0;
+    stepTimer.restart();
+    if (autoVacuum == 2) {
+        freelistCount = pragmaValue(QStringLiteral("freelist_count")).toInt();
+        while (freelistCount > 0 && !m_stopRequested.load()) {
+            if (timer.elapsed() >= m_budget) {
+                budgetExceeded = true;
+                // continue in the next run
+                m_hasChanges.store(1);
+                break;
+            }
+            if (!m_database->queryExec(QString(QStringLiteral("PRAGMA incremental_vacuum(%1)")).arg(m_vacuumPages)))
+                break;
+            m_database->resultSet();
+            vacuumPages += freelistCount;
+            freelistCount = pragmaValue(QStringLiteral("freelist_count")).toInt();
+            vacuumPages -= freelistCount;
+        }
+    }
+    stats.insert(QStringLiteral("vacuumPages"), vacuumPages);
+    stats.insert(QStringLiteral("vacuumMs"), stepTimer.elapsed());
+
+    // the passive checkpoint copy the WAL pages to the database without wait for the readers and writers
+    QVariantMap checkpoint;
+    stepTimer.restart();
+    if (!m_stopRequested.load() && m_database->queryExec(QStringLiteral("PRAGMA wal_checkpoint(PASSIVE)"))) {
+        QVariantList rows(m_database->resultSet());
+        if (!rows.isEmpty())
+            checkpoint = rows.first().toMap();
+    }
+    stats.insert(QStringLiteral("checkpoint"), checkpoint);
+    stats.insert(QStringLiteral("checkpointMs"), stepTimer.elapsed());
+
+    QVariantMap::const_iterator i;
+    QVariantMap currentStats(fileStats());
+    for (i = currentStats.constBegin(); i != currentStats.constEnd(); ++i)
+        stats.insert(i.key(), i.value());
+    stats.insert(QStringLiteral("elapsedMs"), timer.elapsed());
+    stats.insert(QStringLiteral("budgetExceeded"), budgetExceeded || timer.elapsed() > m_budget);
+    stats.insert(QStringLiteral("lastRun"), QDateTime::currentMSecsSinceEpoch());
+
+    QMutexLocker locker(&m_mutex);
+    m_stats = stats;
+    locker.unlock();
+
+    emit m_database->logMessage(QString(QStringLiteral("Database maintenance: %1 pages vacuumed, %2 free pages, %3 bytes, %4 ms"))
+                                .arg(vacuumPages).arg(stats.value(QStringLiteral("freelistCount")).toInt())
+                                .arg(stats.value(QStringLiteral("fileSize")).toLongLong()).arg(timer.elapsed()));
+    emit maintenanceFinished(stats);
+}
@@ -0,0 +1,225 @@
+#ifndef DATABASEMAINTENANCE_H
+#define DATABASEMAINTENANCE_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThread>
+#include <QVariant>
+
+class Database;
+class QTimer;
+
+/**
+ * @brief The DatabaseMaintenance class
+ * @extends QThread
+ * This class implements a Singleton pattern and keep the sqlite file healthy in a background thread:
+ * runs "PRAGMA optimize" to refresh the statistics used by the query planner, "PRAGMA incremental_vacuum" to return
+ * the free pages of the removed rows to the file system, and a passive WAL checkpoint to keep the -wal file small.
+ * The maintenance runs when the application goes to background (or is suspended), and when no table is changed for
+ * 'maintenance_idle_ms' milliseconds, limited to one idle run each 'maintenance_interval_ms'. Only the databases with
+ * changes since the last run are maintained. Each run is limited by 'maintenance_budget_ms': the incremental vacuum
+ * frees 'maintenance_vacuum_pages' pages per step and stops when the budget is over, continuing in the next run.
+ * The options are read from the "database" object of config.json.
+ * The incremental vacuum needs "auto_vacuum" set to INCREMENTAL (the default pragma) when the database file is created.
+ * The files created with auto_vacuum NONE are converted once by a full VACUUM, only in a background run, when the free
+ * pages are at least 'maintenance_vacuum_ratio' of the file and the estimated VACUUM time fits 'maintenance_background_budget_ms'.
+ */
+class DatabaseMaintenance : public QThread
+{
+    Q_OBJECT
+private:
+    /**
+     * @brief DatabaseMaintenance
+     * The object construct
+     * @param parent QObject*
+     */
+    explicit DatabaseMaintenance(QObject *parent = nullptr);
+
+    /**
+     * @brief DatabaseMaintenance
+     * In singleton object, the copy constructor needs to be private
+     * @param other DatabaseMaintenance
+     */
+    DatabaseMaintenance(const DatabaseMaintenance &other);
+
+    /**
+     * @brief operator =
+     * In singleton object, the operator '=' needs to be private
+     */
+    void operator=(const DatabaseMaintenance &);
+
+public:
+    /**
+     * @brief instance
+     * Return the pointer to this object
+     * @return DatabaseMaintenance*
+     */
+    static DatabaseMaintenance *instance();
+
+    /**
+     * @brief requestRun
+     * Start the maintenance thread if the database has changes since the last run.
+     * @param ignoreInterval bool if false, the run is skipped when the last run was less than 'maintenance_interval_ms' ago
+     * @return bool true if the maintenance was started
+     */
+    bool requestRun(bool ignoreInterval = false);
+
+    /**
+     * @brief stop
+     * Stop the running maintenance after the current step and wait the thread finish.
+     * Is called when the application is about to quit.
+     */
+    void stop();
+
+    /**
+     * @brief stats
+     * Return the statistics of the last run (see maintenanceFinished), or the current file statistics if the maintenance never run.
+     * @return QVariantMap
+     */
+    QVariantMap stats();
+
+signals:
+    /**
+     * @brief maintenanceFinished
+     * Emitted by the maintenance thread after each run.
+     * @param stats QVariantMap a map with:
+     * "fileSize"      -> integer the .db file size in bytes
+     * "walSize"       -> integer the -wal file size in bytes
+     * "pageSize"      -> integer the database page size
+     * "pageCount"     -> integer the number of pages of the database
+     * "freelistCount" -> integer the number of free pages, that can be returned by incremental vacuum
+     * "autoVacuum"    -> integer the auto_vacuum mode: 0 (NONE), 1 (FULL) or 2 (INCREMENTAL)
+     * "vacuumPages"   -> integer the number of pages freed by the incremental vacuum in this run
+     * "autoVacuumConverted" -> bool true if the file was converted to auto_vacuum INCREMENTAL by a full VACUUM in this run
+     * "checkpoint"    -> QVariantMap the wal_checkpoint result: "busy", "log" and "checkpointed"
+     * "optimizeMs", "convertMs", "vacuumMs", "checkpointMs" and "elapsedMs" -> integer the time spent in each step and in the run
+     * "budgetExceeded" -> bool true if some step was skipped or interrupted by the time budget
+     * "lastRun"       -> integer the run time in milliseconds since epoch
+     */
+    void maintenanceFinished(const QVariantMap &stats);
+
+protected:
+    /**
+     * @brief run
+     * @overload
+     * Execute the maintenance steps in the thread connection, until the time budget is over
+     * @return void
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief fileStats
+     * Read the page and file statistics of the database in the current thread connection
+     * @return QVariantMap
+     */
+    QVariantMap fileStats();
+
+    /**
+     * @brief pragmaValue
+     * Execute "PRAGMA 'name'" and return the value of the first column
+     * @param name QString the pragma name, like "freelist_count"
+     * @return QVariant
+     */
+    QVariant pragmaValue(const QString &name);
+
+    /**
+     * @brief onApplicationStateChanged
+     * Request a run when the application is hidden or suspended
+     * @param state int a Qt::ApplicationState value
+     */
+    void onApplicationStateChanged(int state);
+
+    /**
+     * @brief m_instance
+     * keeps the DatabaseMaintenance instance pointer
+     */
+    static DatabaseMaintenance *m_instance;
+
+    /**
+     * @brief m_database
+     * A pointer to Database object where execute the maintenance
+     */
+    Database *m_database;
+
+    /**
+     * @brief m_idleTimer
+     * Restarted after each table change, request a run when times out
+     */
+    QTimer *m_idleTimer;
+
+    /**
+     * @brief m_interval
+     * The min interval between two idle runs in milliseconds. From "maintenance_interval_ms", default is 3600000 (one hour).
+     */
+    qint64 m_interval;
+
+    /**
+     * @brief m_budget
+     * The max time of each run in milliseconds. From "maintenance_budget_ms", default is 250.
+     */
+    qint64 m_budget;
+
+    /**
+     * @brief m_vacuumPages
+     * The number of pages freed by each incremental vacuum step. From "maintenance_vacuum_pages", default is 128.
+     */
+    int m_vacuumPages;
+
+    /**
+     * @brief m_vacuumRatio
+     * The min ratio of free pages to convert the file to auto_vacuum INCREMENTAL. From "maintenance_vacuum_ratio", default is 0.25.
+     */
+    double m_vacuumRatio;
+
+    /**
+     * @brief m_backgroundBudget
+     * The max estimated time in milliseconds of the full VACUUM that converts the file to auto_vacuum INCREMENTAL.
+     * From "maintenance_background_budget_ms", default is 5000.
+     */
+    qint64 m_backgroundBudget;
+
+    /**
+     * @brief m_convertAutoVacuum
+     * True if the "auto_vacuum" pragma of config.json is INCREMENTAL, so the files with other modes are converted
+     */
+    bool m_convertAutoVacuum;
+
+    /**
+     * @brief m_isBackground
+     * Set to 1 by requestRun when the application is hidden or suspended, allowing the auto_vacuum conversion
+     */
+    QAtomicInt m_isBackground;
+
+    /**
+     * @brief m_lastRun
+     * The time of the last run in milliseconds since epoch, or zero
+     */
+    qint64 m_lastRun;
+
+    /**
+     * @brief m_hasChanges
+     * Set to 1 when some table is changed, and to 0 when the run starts
+     */
+    QAtomicInt m_hasChanges;
+
+    /**
+     * @brief m_stopRequested
+     * Set to 1 by stop, checked by the run between the steps
+     */
+    QAtomicInt m_stopRequested;
+
+    /**
+     * @brief m_stats
+     * The statistics of the last run
+     */
+    QVariantMap m_stats;
+
+    /**
+     * @brief m_mutex
+     * Protect the m_stats access
+     */
+    QMutex m_mutex;
+};
+
+#endif // DATABASEMAINTENANCE_H
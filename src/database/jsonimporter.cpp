@@ -0,0 +1,314 @@
+#include "jsonimporter.h"
+#include "database.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QNetworkReply>
+
+// the size of each read from the source
+static const int ChunkSize = 65536;
+
+JsonImporter::JsonImporter(int importId, const QString &tableName, const QVariantMap &options, QObject *parent)
+  : QThread(parent)
+  ,m_importId(importId)
+  ,m_tableName(tableName)
+  ,m_fields(options.value(QStringLiteral("fields")).toMap())
+  ,m_conflictColumns(options.value(QStringLiteral("conflictColumns")).toStringList())
+  ,m_isUpsert(options.value(QStringLiteral("mode")).toString() == QStringLiteral("upsert"))
+  ,m_ignoreConflicts(options.value(QStringLiteral("ignoreConflicts"), true).toBool())
+  ,m_batchSize(qMax(1, options.value(QStringLiteral("batchSize"), 500).toInt()))
+  ,m_device(nullptr)
+  ,m_reply(nullptr)
+  ,m_maxBufferSize(ChunkSize * 4)
+  ,m_isInputFinished(false)
+  ,m_format(Unknown)
+  ,m_inElement(false)
+  ,m_inString(false)
+  ,m_escape(false)
+  ,m_depth(0)
+  ,m_rowsRead(0)
+  ,m_inserted(0)
+  ,m_ignored(0)
+  ,m_failed(0)
+  ,m_bytesRead(0)
+  ,m_totalBytes(-1)
+{
+    m_database = Database::instance();
+}
+
+void JsonImporter::setFileName(const QString &fileName)
+{
+    m_fileName = fileName;
+}
+
+void JsonImporter::setDevice(QIODevice *device)
+{
+    m_device = device;
+}
+
+void JsonImporter::setReply(QNetworkReply *reply)
+{
+    m_reply = reply;
+    m_reply->setParent(this);
+    // the reply stops to read the socket while his buffer is full, until the importer consumes the data
+    m_reply->setReadBufferSize(m_maxBufferSize);
+    connect(m_reply, &QNetworkReply::readyRead, this, &JsonImporter::readReply);
+    connect(m_reply, &QNetworkReply::finished, this, &JsonImporter::readReply);
+    connect(this, &JsonImporter::dataConsumed, this, &JsonImporter::readReply, Qt::QueuedConnection);
+}
+
+void JsonImporter::cancel()
+{
+    m_canceled.store(1);
+    if (m_reply)
+        QMetaObject::invokeMethod(m_reply, "abort", Qt::QueuedConnection);
+    QMutexLocker locker(&m_mutex);
+    m_bufferReady.wakeAll();
+}
+
+bool JsonImporter::isCanceled() const
+{
+    return m_canceled.load() == 1;
+}
+
+void JsonImporter::readReply()
+{
+    if (!m_reply)
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    if (m_isInputFinished)
+        return;
+
+    if (m_totalBytes < 0 && m_reply->header(QNetworkRequest::ContentLengthHeader).isValid())
+        m_totalBytes = m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+
+    if (m_reply->error() != QNetworkReply::NoError) {
+        // the body of a failed request is not a valid source
+        if (!isCanceled())
+            m_error = m_reply->errorString();
+        m_isInputFinished = true;
+    } else {
+        int available = m_maxBufferSize - m_buffer.size();
+        if (available > 0 && m_reply->bytesAvailable() > 0)
+            m_buffer.append(m_reply->read(available));
+        m_isInputFinished = m_reply->isFinished() && m_reply->bytesAvailable() == 0;
+    }
+    m_bufferReady.wakeAll();
+}
+
+bool JsonImporter::nextChunk(QIODevice *device, QByteArray *chunk)
+{
+    if (device) {
+        *chunk = device->read(ChunkSize);
+    } else {
+        QMutexLocker locker(&m_mutex);
+        while (m_buffer.isEmpty() && !m_isInputFinished && !isCanceled())
+            m_bufferReady.wait(&m_mutex);
+        *chunk = m_buffer;
+        m_buffer.clear();
+        locker.unlock();
+        // request more data from the reply, in the reply thread
+        emit dataConsumed();
+    }
+    m_bytesRead += chunk->size();
+    return !chunk->isEmpty();
+}
+
+void JsonImporter::parse(const QByteArray &chunk)
+{
+    const char *data = chunk.constData();
+    int size = chunk.size();
+    // the start of the current element in this chunk, or -1 if the chunk has no element started
+    int start = m_inElement ? 0 : -1;
+
+    for (int i = 0; i < size && m_format != Finished; ++i) {
+        char c = data[i];
+        if (m_format == Unknown) {
+            // skip the white spaces and the UTF-8 byte order mark before the first char
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || static_cast<uchar>(c) == 0xEF || static_cast<uchar>(c) == 0xBB || static_cast<uchar>(c) == 0xBF)
+                continue;
+            if (c == '[') {
+                m_format = Array;
+                continue;
+            }
+            m_format = Lines;
+        }
+
+        if (!m_inElement) {
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',')
+                continue;
+            if (c == ']' && m_format == Array) {
+                m_format = Finished;
+                break;
+            }
+            m_inElement = true;
+            m_inString = false;
+            m_escape = false;
+            m_depth = 0;
+            start = i;
+        }
+
+        if (m_inString) {
+            if (m_escape)
+                m_escape = false;
+            else if (c == '\\')
+                m_escape = true;
+            else if (c == '"')
+                m_inString = false;
+            continue;
+        }
+
+        if (c == '"') {
+            m_inString = true;
+        } else if (c == '{' || c == '[') {
+            ++m_depth;
+        } else if (m_depth > 0 && (c == '}' || c == ']')) {
+            if (--m_depth == 0) {
+                m_element.append(data + start, i - start + 1);
+                addElement();
+                start = -1;
+            }
+        } else if (m_depth == 0 && (c == ',' || c == '\n' || c == ']')) {
+            // the end of a scalar value, that will be counted as a failed row
+            m_element.append(data + start, i - start);
+            addElement();
+            start = -1;
+            if (c == ']' && m_format == Array)
+                m_format = Finished;
+        }
+    }
+
+    // keep the incomplete element to the next chunk
+    if (m_inElement && start >= 0)
+        m_element.append(data + start, size - start);
+}
+
+void JsonImporter::addElement()
+{
+    ++m_rowsRead;
+    QJsonParseError error;
+    QJsonDocument document(QJsonDocument::fromJson(m_element, &error));
+    m_element.clear();
+    m_inElement = false;
+
+    if (error.error != QJsonParseError::NoError || !document.isObject()) {
+        ++m_failed;
+        return;
+    }
+
+    QString column;
+    QVariantMap row;
+    const QJsonObject object(document.object());
+    QJsonObject::const_iterator i = object.constBegin();
+    for (; i != object.constEnd(); ++i) {
+        column = m_fields.value(i.key(), i.key()).toString();
+        if (!m_columns.contains(column))
+            continue;
+        const QJsonValue value(i.value());
+        if (value.isObject() || value.isArray()) {
+            QByteArray cbor;
+            if (m_cborColumns.contains(column))
+                cbor = Database::encodeCbor(value.toVariant());
+            if (!cbor.isEmpty()) {
+                row.insert(column, cbor);
+            } else {
+                QJsonDocument nested(value.isObject() ? QJsonDocument(value.toObject()) : QJsonDocument(value.toArray()));
+                row.insert(column, QString::fromUtf8(nested.toJson(QJsonDocument::Compact)));
+            }
+        } else {
+            row.insert(column, value.toVariant());
+        }
+    }
+
+    if (row.isEmpty()) {
+        ++m_failed;
+        return;
+    }
+
+    m_rows << row;
+    if (m_rows.size() >= m_batchSize)
+        flush();
+}
+
+void JsonImporter::flush()
+{
+    if (m_rows.isEmpty())
+        return;
+
+    QVariantMap result;
+    if (m_isUpsert) {
+        result = m_database->upsertBatch(m_tableName, m_rows, m_conflictColumns);
+        m_inserted += result.value(QStringLiteral("affected")).toInt();
+    } else {
+        result = m_database->insertBatch(m_tableName, m_rows, m_ignoreConflicts);
+        m_inserted += result.value(QStringLiteral("inserted")).toInt();
+        m_ignored += result.value(QStringLiteral("ignored")).toInt();
+    }
+    m_failed += result.value(QStringLiteral("failed")).toInt();
+    m_rows.clear();
+
+    qint64 totalBytes = m_totalBytes;
+    if (m_reply) {
+        QMutexLocker locker(&m_mutex);
+        totalBytes = m_totalBytes;
+    }
+    emit progress(m_importId, m_tableName, m_rowsRead, m_bytesRead, totalBytes);
+}
+
+void JsonImporter::run()
+{
+    QFile file;
+    QIODevice *device = m_device;
+    m_columns = m_database->tableColumns(m_tableName);
+    m_cborColumns = m_database->cborColumns(m_tableName);
+
+    QMutexLocker locker(&m_mutex);
+    if (m_columns.isEmpty()) {
+        m_error = QStringLiteral("The table '") + m_tableName + QStringLiteral("' does not exists!");
+    } else if (!m_fileName.isEmpty()) {
+        file.setFileName(m_fileName);
+        if (file.open(QIODevice::ReadOnly)) {
+            device = &file;
+        } else {
+            m_error = file.errorString();
+        }
+    } else if (!device && !m_reply) {
+        m_error = QStringLiteral("The import has no source!");
+    }
+    bool isReady = m_error.isEmpty();
+    locker.unlock();
+
+    if (isReady) {
+        if (device && !device->isSequential())
+            m_totalBytes = device->size();
+
+        QByteArray chunk;
+        while (!isCanceled() && m_format != Finished && nextChunk(device, &chunk))
+            parse(chunk);
+
+        if (!isCanceled()) {
+            // the last NDJSON line may not have the line break. A truncated object is counted as failed.
+            if (m_inElement)
+                addElement();
+            flush();
+        }
+    }
+
+    QVariantMap result;
+    locker.relock();
+    if (m_error.isEmpty() && m_format == Array && !isCanceled())
+        m_error = QStringLiteral("The json array is incomplete!");
+    result.insert(QStringLiteral("error"), m_error);
+    locker.unlock();
+    result.insert(QStringLiteral("rows"), m_rowsRead);
+    result.insert(QStringLiteral("inserted"), m_inserted);
+    result.insert(QStringLiteral("ignored"), m_ignored);
+    result.insert(QStringLiteral("failed"), m_failed);
+    result.insert(QStringLiteral("bytes"), m_bytesRead);
+    result.insert(QStringLiteral("canceled"), isCanceled());
+    emit importFinished(m_importId, m_tableName, result);
+}
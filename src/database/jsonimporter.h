@@ -0,0 +1,223 @@
+#ifndef JSONIMPORTER_H
+#define JSONIMPORTER_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QVariant>
+#include <QWaitCondition>
+
+class Database;
+class QIODevice;
+class QNetworkReply;
+
+/**
+ * @brief The JsonImporter class
+ * @extends QThread
+ * This class import a json array ('[{...}, {...}]') or a NDJSON file (one json object by line) into a database table,
+ * reading the source in chunks and parsing each object as soon as it is complete. The objects are mapped to the table
+ * columns and inserted (or upserted) in batches of 'batchSize' rows, each batch in a single transaction.
+ * So, the memory used is bounded by the chunk size and the batch size, and not by the size of the source.
+ * The source can be a file (read by the importer thread), a QIODevice or a QNetworkReply. The reply is read in the
+ * object thread (the GUI thread) into a bounded buffer consumed by the importer thread, and the reply stops
+ * to download while the buffer is full.
+ * The objects are created by Database::importJson and deleted after the run finish.
+ */
+class JsonImporter : public QThread
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief JsonImporter
+     * @param importId int the import id, sent in the signals
+     * @param tableName QString the table to import the rows
+     * @param options QVariantMap the import options (see Database::importJson)
+     * @param parent QObject* the object parent
+     */
+    explicit JsonImporter(int importId, const QString &tableName, const QVariantMap &options, QObject *parent = nullptr);
+
+    /**
+     * @brief setFileName
+     * Set a file as source. The file is opened and read by the importer thread.
+     * @param fileName QString the file path (or a resource path started with ':')
+     */
+    void setFileName(const QString &fileName);
+
+    /**
+     * @brief setDevice
+     * Set a opened device as source. The device is read by the importer thread and needs to be
+     * kept alive (and not used by other threads) until the importFinished signal.
+     * @param device QIODevice*
+     */
+    void setDevice(QIODevice *device);
+
+    /**
+     * @brief setReply
+     * Set a network reply as source. The reply is read in this object thread and needs to be
+     * created in the same thread. The importer takes the ownership of the reply.
+     * @param reply QNetworkReply*
+     */
+    void setReply(QNetworkReply *reply);
+
+    /**
+     * @brief cancel
+     * Stop the import. The rows of the committed batches are kept.
+     */
+    void cancel();
+
+    /**
+     * @brief isCanceled
+     * @return bool
+     */
+    bool isCanceled() const;
+
+signals:
+    /**
+     * @brief progress
+     * This signal will be emitted after each batch is committed.
+     * @param importId int the import id
+     * @param tableName QString the table name
+     * @param rows int the number of rows read until now
+     * @param bytes qint64 the number of bytes read until now
+     * @param totalBytes qint64 the source size, or -1 if unknown
+     */
+    void progress(int importId, const QString &tableName, int rows, qint64 bytes, qint64 totalBytes);
+
+    /**
+     * @brief importFinished
+     * This signal will be emitted at the end of the import, even if the import fails or is canceled.
+     * @param importId int the import id
+     * @param tableName QString the table name
+     * @param result QVariantMap a map with:
+     * "rows"     -> integer the number of json objects read
+     * "inserted" -> integer the number of rows inserted (or upserted)
+     * "ignored"  -> integer the number of rows ignored by a primary key conflict
+     * "failed"   -> integer the number of invalid objects and rows not inserted
+     * "bytes"    -> integer the number of bytes read
+     * "canceled" -> bool true if the import was canceled
+     * "error"    -> QString the error message, or a empty string
+     */
+    void importFinished(int importId, const QString &tableName, const QVariantMap &result);
+
+    /**
+     * @brief dataConsumed
+     * This signal will be emitted by the importer thread after take the buffered reply data, to read more data from the reply.
+     */
+    void dataConsumed();
+
+protected:
+    /**
+     * @brief run
+     * @overload
+     * Read and parse the source, inserting the rows in batches
+     * @return void
+     */
+    void run() override;
+
+private slots:
+    /**
+     * @brief readReply
+     * Move the available reply data to the buffer, until the buffer is full
+     */
+    void readReply();
+
+private:
+    /**
+     * @brief The Format enum
+     * The source format, detected by the first char: '[' is a json array, otherwise is NDJSON
+     */
+    enum Format {
+        Unknown,
+        Array,
+        Lines,
+        Finished
+    };
+
+    /**
+     * @brief nextChunk
+     * Read the next chunk of the source. For the network reply, wait until the buffer has data.
+     * @param device QIODevice* the opened file or device, or nullptr to read the network reply buffer
+     * @param chunk QByteArray* the read data
+     * @return bool false at the end of the source
+     */
+    bool nextChunk(QIODevice *device, QByteArray *chunk);
+
+    /**
+     * @brief parse
+     * Split the chunk in json objects, keeping the incomplete object to the next chunk
+     * @param chunk QByteArray
+     */
+    void parse(const QByteArray &chunk);
+
+    /**
+     * @brief addElement
+     * Parse the current json object, map the object keys to the table columns and append to the batch
+     */
+    void addElement();
+
+    /**
+     * @brief flush
+     * Insert the batch rows in a single transaction and emit the progress signal
+     */
+    void flush();
+
+    int m_importId;
+    QString m_tableName;
+    Database *m_database;
+
+    /**
+     * @brief m_fields
+     * Rename the object keys to columns names: json_key -> column_name. From "fields" option.
+     */
+    QVariantMap m_fields;
+
+    /**
+     * @brief m_conflictColumns
+     * The conflict columns used by the upsert. From "conflictColumns" option.
+     */
+    QStringList m_conflictColumns;
+
+    bool m_isUpsert;
+    bool m_ignoreConflicts;
+    int m_batchSize;
+    QStringList m_columns;
+    QStringList m_cborColumns;
+    QVariantList m_rows;
+
+    QString m_fileName;
+    QIODevice *m_device;
+    QNetworkReply *m_reply;
+
+    /**
+     * @brief m_buffer
+     * The reply data not yet parsed, limited to m_maxBufferSize bytes
+     */
+    QByteArray m_buffer;
+    int m_maxBufferSize;
+    bool m_isInputFinished;
+    QMutex m_mutex;
+    QWaitCondition m_bufferReady;
+
+    /**
+     * @brief m_element
+     * The bytes of the current json object, kept between the chunks
+     */
+    QByteArray m_element;
+    Format m_format;
+    bool m_inElement;
+    bool m_inString;
+    bool m_escape;
+    int m_depth;
+
+    int m_rowsRead;
+    int m_inserted;
+    int m_ignored;
+    int m_failed;
+    qint64 m_bytesRead;
+    qint64 m_totalBytes;
+    QString m_error;
+    QAtomicInt m_canceled;
+};
+
+#endif // JSONIMPORTER_H
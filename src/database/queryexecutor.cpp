@@ -0,0 +1,45 @@
+#include "queryexecutor.h"
+#include "../core/utils.h"
+
+#include <QRunnable>
+#include <QThread>
+
+QueryExecutor* QueryExecutor::m_instance = nullptr;
+
+QueryExecutor::QueryExecutor(QObject *parent) : QObject(parent)
+{
+    // one thread per core. The ConnectionPool limits the worker connections to this count,
+    // and the GUI and dedicated threads (like WriteQueue) are not counted
+    int maxThreadCount = qMax(2, QThread::idealThreadCount());
+    QVariantMap config(Utils::instance()->readFile(QStringLiteral(":/config.json")).toMap().value(QStringLiteral("database")).toMap());
+    if (config.value(QStringLiteral("query_threads")).toInt() > 0)
+        maxThreadCount = config.value(QStringLiteral("query_threads")).toInt();
+    m_threadPool.setMaxThreadCount(maxThreadCount);
+}
+
+QueryExecutor *QueryExecutor::instance()
+{
+    if (!QueryExecutor::m_instance)
+        QueryExecutor::m_instance = new QueryExecutor;
+    return QueryExecutor::m_instance;
+}
+
+void QueryExecutor::start(QRunnable *runnable, int priority)
+{
+    m_threadPool.start(runnable, priority);
+}
+
+bool QueryExecutor::cancel(QRunnable *runnable)
+{
+    return m_threadPool.tryTake(runnable);
+}
+
+int QueryExecutor::maxThreadCount() const
+{
+    return m_threadPool.maxThreadCount();
+}
+
+int QueryExecutor::activeThreadCount() const
+{
+    return m_threadPool.activeThreadCount();
+}
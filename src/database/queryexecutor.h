@@ -0,0 +1,95 @@
+#ifndef QUERYEXECUTOR_H
+#define QUERYEXECUTOR_H
+
+#include <QObject>
+#include <QThreadPool>
+
+class QRunnable;
+
+/**
+ * @brief The QueryExecutor class
+ * This class implements a Singleton pattern and execute the database background tasks (like AsyncSelect)
+ * in a shared and bounded QThreadPool. The pool threads are reused by all tasks and each thread keeps your
+ * own Database connection while is alive, so the number of threads (and connections) stay flat no matter how many
+ * tasks are started. The tasks waiting in the queue are ordered by priority and can be removed before start.
+ * The max number of threads can be set by "query_threads" in the "database" object of config.json.
+ */
+class QueryExecutor : public QObject
+{
+    Q_OBJECT
+private:
+    /**
+     * @brief QueryExecutor
+     * The object construct
+     * @param parent QObject*
+     */
+    explicit QueryExecutor(QObject *parent = nullptr);
+
+    /**
+     * @brief QueryExecutor
+     * In singleton object, the copy constructor needs to be private
+     * @param other QueryExecutor
+     */
+    QueryExecutor(const QueryExecutor &other);
+
+    /**
+     * @brief operator =
+     * In singleton object, the operator '=' needs to be private
+     */
+    void operator=(const QueryExecutor &);
+
+public:
+    /**
+     * @brief instance
+     * Return the pointer to this object
+     * @return QueryExecutor*
+     */
+    static QueryExecutor *instance();
+
+    /**
+     * @brief start
+     * Put the task in the thread pool queue, to be executed when some thread is available.
+     * Tasks with greater priority are executed first.
+     * @param runnable QRunnable* the task to execute
+     * @param priority int the task priority in the queue
+     */
+    void start(QRunnable *runnable, int priority = 0);
+
+    /**
+     * @brief cancel
+     * Remove the task from the thread pool queue if the task is not yet started.
+     * A task removed from the queue is not deleted, even if QRunnable::autoDelete() is true.
+     * @param runnable QRunnable* the task to remove
+     * @return bool true if the task was removed from the queue, or false if is already running or finished
+     */
+    bool cancel(QRunnable *runnable);
+
+    /**
+     * @brief maxThreadCount
+     * Return the max number of threads used by the thread pool
+     * @return int
+     */
+    int maxThreadCount() const;
+
+    /**
+     * @brief activeThreadCount
+     * Return the number of threads running some task
+     * @return int
+     */
+    int activeThreadCount() const;
+
+private:
+    /**
+     * @brief m_instance
+     * keeps the QueryExecutor instance pointer
+     */
+    static QueryExecutor *m_instance;
+
+    /**
+     * @brief m_threadPool
+     * The bounded thread pool where the tasks are executed
+     */
+    QThreadPool m_threadPool;
+};
+
+#endif // QUERYEXECUTOR_H
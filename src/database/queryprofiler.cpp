@@ -0,0 +1,211 @@
+#include "queryprofiler.h"
+#include "../core/utils.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <algorithm>
+
+QueryProfiler* QueryProfiler::m_instance = nullptr;
+
+// the upper bound of each histogram bucket in microseconds. The last bucket has no upper bound
+static const qint64 bucketBoundsUs[] = {100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000};
+static const int totalBuckets = sizeof(bucketBoundsUs) / sizeof(bucketBoundsUs[0]) + 1;
+
+QueryProfiler::QueryProfiler(QObject *parent) : QObject(parent)
+  ,m_slowQueryMs(100)
+{
+#ifdef QT_DEBUG
+    m_enabled.store(1);
+#endif
+    QVariantMap config(Utils::instance()->readFile(QStringLiteral(":/config.json")).toMap().value(QStringLiteral("database")).toMap());
+    if (config.contains(QStringLiteral("profile_queries")))
+        setEnabled(config.value(QStringLiteral("profile_queries")).toBool());
+    if (config.value(QStringLiteral("slow_query_ms")).toInt() > 0)
+        setSlowQueryMs(config.value(QStringLiteral("slow_query_ms")).toInt());
+    setDumpFile(config.value(QStringLiteral("profile_dump_file")).toString());
+
+    // save the report before the application quit
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() {
+            QMutexLocker locker(&m_mutex);
+            QString dumpFile(m_dumpFile);
+            locker.unlock();
+            if (!dumpFile.isEmpty() && isEnabled())
+                dump(dumpFile);
+        });
+    }
+}
+
+QueryProfiler *QueryProfiler::instance()
+{
+    if (!QueryProfiler::m_instance)
+        QueryProfiler::m_instance = new QueryProfiler;
+    return QueryProfiler::m_instance;
+}
+
+bool QueryProfiler::isEnabled() const
+{
+    return m_enabled.load() == 1;
+}
+
+void QueryProfiler::setEnabled(bool enabled)
+{
+    m_enabled.store(enabled ? 1 : 0);
+}
+
+int QueryProfiler::slowQueryMs() const
+{
+    return m_slowQueryMs.load();
+}
+
+void QueryProfiler::setSlowQueryMs(int slowQueryMs)
+{
+    m_slowQueryMs.store(qMax(0, slowQueryMs));
+}
+
+void QueryProfiler::setDumpFile(const QString &dumpFile)
+{
+    QMutexLocker locker(&m_mutex);
+    m_dumpFile = dumpFile;
+}
+
+QString QueryProfiler::normalize(const QString &sql)
+{
+    QString normalized(sql);
+    // the regular expressions are not shared between threads
+    normalized.replace(QRegExp(QStringLiteral("'(?:[^']|'')*'")), QStringLiteral("?"));
+    normalized.replace(QRegExp(QStringLiteral("\\b\\d+(\\.\\d+)?\\b")), QStringLiteral("?"));
+    normalized.replace(QRegExp(QStringLiteral("\\?(\\s*,\\s*\\?)+")), QStringLiteral("?, ..."));
+    return normalized.simplified();
+}
+
+QStringList QueryProfiler::histogramBuckets()
+{
+    QStringList buckets;
+    for (int i = 0; i < totalBuckets - 1; ++i)
+        buckets << QStringLiteral("<") + (bucketBoundsUs[i] < 1000 ? QString::number(bucketBoundsUs[i]) + QStringLiteral("us") : QString::number(bucketBoundsUs[i] / 1000) + QStringLiteral("ms"));
+    buckets << QStringLiteral(">=") + QString::number(bucketBoundsUs[totalBuckets - 2] / 1000) + QStringLiteral("ms");
+    return buckets;
+}
+
+bool QueryProfiler::record(const QString &sql, qint64 elapsedNs, int rows, bool cacheHit)
+{
+    if (!isEnabled())
+        return false;
+
+    int bucket = 0;
+    qint64 elapsedUs = elapsedNs / 1000;
+    while (bucket < totalBuckets - 1 && elapsedUs >= bucketBoundsUs[bucket])
+        ++bucket;
+    bool isSlow = elapsedNs >= static_cast<qint64>(slowQueryMs()) * 1000000;
+    QString normalized(normalize(sql));
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_statistics.contains(normalized)) {
+        Statistics statistics;
+        statistics.count = 0;
+        statistics.totalNs = 0;
+        statistics.minNs = elapsedNs;
+        statistics.maxNs = elapsedNs;
+        statistics.rows = 0;
+        statistics.cacheHits = 0;
+        statistics.slowCount = 0;
+        statistics.histogram.fill(0, totalBuckets);
+        m_statistics.insert(normalized, statistics);
+    }
+
+    Statistics &statistics = m_statistics[normalized];
+    ++statistics.count;
+    statistics.totalNs += elapsedNs;
+    statistics.minNs = qMin(statistics.minNs, elapsedNs);
+    statistics.maxNs = qMax(statistics.maxNs, elapsedNs);
+    if (rows > 0)
+        statistics.rows += rows;
+    if (cacheHit)
+        ++statistics.cacheHits;
+    ++statistics.histogram[bucket];
+    if (isSlow)
+        ++statistics.slowCount;
+
+    // the plan is captured once for each normalized SQL
+    return isSlow && statistics.plan.isEmpty();
+}
+
+void QueryProfiler::setPlan(const QString &sql, const QStringList &plan)
+{
+    QString normalized(normalize(sql));
+    QMutexLocker locker(&m_mutex);
+    if (m_statistics.contains(normalized))
+        m_statistics[normalized].plan = plan;
+    locker.unlock();
+    emit logMessage(QStringLiteral("Slow query: ") + normalized + QStringLiteral("\nQuery plan: ") + plan.join(QStringLiteral(" | ")));
+}
+
+QVariantMap QueryProfiler::report()
+{
+    QVariantList queries;
+    QVariantList histogram;
+    QVariantMap query;
+    bool fullScan = false;
+
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, Statistics>::const_iterator i = m_statistics.constBegin();
+    for (; i != m_statistics.constEnd(); ++i) {
+        const Statistics &statistics = i.value();
+        histogram.clear();
+        foreach (int count, statistics.histogram)
+            histogram << count;
+        // a 'SCAN table' without index means that all rows of the table are read
+        fullScan = false;
+        foreach (const QString &line, statistics.plan)
+            fullScan = fullScan || (line.startsWith(QStringLiteral("SCAN")) && !line.contains(QStringLiteral("INDEX")));
+
+        query.clear();
+        query.insert(QStringLiteral("sql"), i.key());
+        query.insert(QStringLiteral("count"), statistics.count);
+        query.insert(QStringLiteral("totalMs"), statistics.totalNs / 1000000.0);
+        query.insert(QStringLiteral("avgMs"), statistics.totalNs / 1000000.0 / statistics.count);
+        query.insert(QStringLiteral("minMs"), statistics.minNs / 1000000.0);
+        query.insert(QStringLiteral("maxMs"), statistics.maxNs / 1000000.0);
+        query.insert(QStringLiteral("rows"), statistics.rows);
+        query.insert(QStringLiteral("cacheHits"), statistics.cacheHits);
+        query.insert(QStringLiteral("slowCount"), statistics.slowCount);
+        query.insert(QStringLiteral("histogram"), histogram);
+        query.insert(QStringLiteral("plan"), statistics.plan);
+        query.insert(QStringLiteral("fullScan"), fullScan);
+        queries << query;
+    }
+    locker.unlock();
+
+    // the most expensive statements first
+    std::sort(queries.begin(), queries.end(), [](const QVariant &a, const QVariant &b) {
+        return a.toMap().value(QStringLiteral("totalMs")).toDouble() > b.toMap().value(QStringLiteral("totalMs")).toDouble();
+    });
+
+    QVariantMap report;
+    report.insert(QStringLiteral("slowQueryMs"), slowQueryMs());
+    report.insert(QStringLiteral("buckets"), histogramBuckets());
+    report.insert(QStringLiteral("queries"), queries);
+    return report;
+}
+
+bool QueryProfiler::dump(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        emit logMessage(QStringLiteral("Error on try save the query profiler report in '") + filePath + QStringLiteral("'"));
+        return false;
+    }
+    file.write(QJsonDocument::fromVariant(report()).toJson());
+    file.close();
+    return true;
+}
+
+void QueryProfiler::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_statistics.clear();
+}
@@ -0,0 +1,258 @@
+#ifndef QUERYPROFILER_H
+#define QUERYPROFILER_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+/**
+ * @brief The QueryProfiler class
+ * This class implements a Singleton pattern and aggregate the execution statistics of the database statements.
+ * The statements are grouped by the normalized SQL (the literal values replaced by '?'), and for each group keeps
+ * the number of executions, the wall time (total, min, max and a histogram), the rows returned or affected and the
+ * number of executions that reused a prepared statement from the cache.
+ * When a statement is slower than 'slowQueryMs', the Database capture the 'EXPLAIN QUERY PLAN' of the statement once,
+ * to show if the statement make a full table scan (and the table needs some index).
+ * The profiler is enabled by default in debug mode, or by "profile_queries" in the "database" object of config.json.
+ * The report can be read by Database::profilerReport() or saved as json in the "profile_dump_file" at application exit.
+ */
+class QueryProfiler : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief The Statistics struct
+     * Keeps the aggregated statistics of a normalized SQL
+     */
+    struct Statistics
+    {
+        /**
+         * @brief count
+         * The number of executions
+         */
+        int count;
+
+        /**
+         * @brief totalNs
+         * The sum of the execution times in nanoseconds
+         */
+        qint64 totalNs;
+
+        /**
+         * @brief minNs
+         * The fastest execution time in nanoseconds
+         */
+        qint64 minNs;
+
+        /**
+         * @brief maxNs
+         * The slowest execution time in nanoseconds
+         */
+        qint64 maxNs;
+
+        /**
+         * @brief rows
+         * The sum of rows returned (selects) or affected (writes)
+         */
+        qint64 rows;
+
+        /**
+         * @brief cacheHits
+         * The number of executions that reused a prepared statement from the cache
+         */
+        int cacheHits;
+
+        /**
+         * @brief slowCount
+         * The number of executions slower than the slow query threshold
+         */
+        int slowCount;
+
+        /**
+         * @brief histogram
+         * The number of executions in each time bucket (see histogramBuckets)
+         */
+        QVector<int> histogram;
+
+        /**
+         * @brief plan
+         * The 'EXPLAIN QUERY PLAN' lines, captured in the first slow execution
+         */
+        QStringList plan;
+    };
+
+private:
+    /**
+     * @brief QueryProfiler
+     * The object construct
+     * @param parent QObject*
+     */
+    explicit QueryProfiler(QObject *parent = nullptr);
+
+    /**
+     * @brief QueryProfiler
+     * In singleton object, the copy constructor needs to be private
+     * @param other QueryProfiler
+     */
+    QueryProfiler(const QueryProfiler &other);
+
+    /**
+     * @brief operator =
+     * In singleton object, the operator '=' needs to be private
+     */
+    void operator=(const QueryProfiler &);
+
+public:
+    /**
+     * @brief instance
+     * Return the pointer to this object
+     * @return QueryProfiler*
+     */
+    static QueryProfiler *instance();
+
+    /**
+     * @brief isEnabled
+     * @return bool
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief setEnabled
+     * Enable or disable the statistics collect. When disabled, record does nothing.
+     * @param enabled bool
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief slowQueryMs
+     * Return the time in milliseconds from which a statement is slow
+     * @return int
+     */
+    int slowQueryMs() const;
+
+    /**
+     * @brief setSlowQueryMs
+     * Set the time in milliseconds from which a statement is slow. The default is 100.
+     * @param slowQueryMs int
+     */
+    void setSlowQueryMs(int slowQueryMs);
+
+    /**
+     * @brief setDumpFile
+     * Set the file path where the report is saved as json when the application is about to quit.
+     * @param dumpFile QString
+     */
+    void setDumpFile(const QString &dumpFile);
+
+    /**
+     * @brief normalize
+     * Return the SQL with the string and number literals replaced by '?' and the whitespaces collapsed,
+     * so the statements that differ only by values are grouped together. A list of '?' (like in 'IN (?, ?, ?)') is collapsed.
+     * @param sql QString
+     * @return QString
+     */
+    static QString normalize(const QString &sql);
+
+    /**
+     * @brief record
+     * Add a execution of the 'sql' to the statistics.
+     * @param sql QString the executed SQL
+     * @param elapsedNs qint64 the execution time in nanoseconds
+     * @param rows int the rows returned or affected. If is less than zero, is not counted.
+     * @param cacheHit bool true if the statement was reused from the prepared statements cache
+     * @return bool true if the execution is slow and the query plan of this SQL was not captured yet
+     */
+    bool record(const QString &sql, qint64 elapsedNs, int rows, bool cacheHit);
+
+    /**
+     * @brief setPlan
+     * Save the 'EXPLAIN QUERY PLAN' lines of the 'sql' and log the slow query with the plan.
+     * @param sql QString the executed SQL
+     * @param plan QStringList the plan lines
+     */
+    void setPlan(const QString &sql, const QStringList &plan);
+
+    /**
+     * @brief report
+     * Return the statistics as a map with:
+     * "slowQueryMs" -> integer the slow query threshold
+     * "buckets"     -> QStringList the histogram buckets names
+     * "queries"     -> QVariantList a map for each normalized SQL, sorted by the total time (the most expensive first), with:
+     *                  "sql", "count", "totalMs", "avgMs", "minMs", "maxMs", "rows", "cacheHits", "slowCount",
+     *                  "histogram" (a list with the count of each bucket), "plan" and "fullScan" (true if the plan has a table SCAN)
+     * @return QVariantMap
+     */
+    QVariantMap report();
+
+    /**
+     * @brief dump
+     * Save the report as json in 'filePath'
+     * @param filePath QString
+     * @return bool
+     */
+    bool dump(const QString &filePath);
+
+    /**
+     * @brief reset
+     * Remove all statistics
+     */
+    void reset();
+
+    /**
+     * @brief histogramBuckets
+     * Return the histogram buckets names, like "<1ms"
+     * @return QStringList
+     */
+    static QStringList histogramBuckets();
+
+signals:
+    /**
+     * @brief logMessage
+     * Send the slow queries with the query plan
+     * @param message QString
+     */
+    void logMessage(const QString &message);
+
+private:
+    /**
+     * @brief m_instance
+     * keeps the QueryProfiler instance pointer
+     */
+    static QueryProfiler *m_instance;
+
+    /**
+     * @brief m_enabled
+     * Set to 1 when the profiler is enabled
+     */
+    QAtomicInt m_enabled;
+
+    /**
+     * @brief m_slowQueryMs
+     * The slow query threshold in milliseconds
+     */
+    QAtomicInt m_slowQueryMs;
+
+    /**
+     * @brief m_mutex
+     * Protect m_statistics from concurrent access, because the statements are executed by many threads
+     */
+    QMutex m_mutex;
+
+    /**
+     * @brief m_statistics
+     * The statistics of each normalized SQL
+     */
+    QHash<QString, Statistics> m_statistics;
+
+    /**
+     * @brief m_dumpFile
+     * The file where the report is saved at application exit. If empty, the report is not saved.
+     */
+    QString m_dumpFile;
+};
+
+#endif // QUERYPROFILER_H
@@ -0,0 +1,153 @@
+#include "resultcache.h"
+
+#include <QMutexLocker>
+#include <QRegExp>
+
+ResultCache::ResultCache(int maxSize)
+  : m_hits(0)
+  ,m_misses(0)
+{
+    m_cache.setMaxCost(qMax(0, maxSize));
+}
+
+bool ResultCache::isEnabled()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost() > 0;
+}
+
+int ResultCache::maxSize()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost();
+}
+
+void ResultCache::setMaxSize(int maxSize)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(qMax(0, maxSize));
+}
+
+bool ResultCache::find(const QString &key, Entry *entry)
+{
+    QMutexLocker locker(&m_mutex);
+    // QCache::object move the entry to the front of the least recently used list
+    Entry *cached = m_cache.object(key);
+    if (!cached) {
+        ++m_misses;
+        return false;
+    }
+    ++m_hits;
+    *entry = *cached;
+    return true;
+}
+
+int ResultCache::generation(const QString &tableName)
+{
+    QMutexLocker locker(&m_mutex);
+    // the table is added to the generations, so a write made while the query is running is known by invalidateQuery
+    if (!m_generations.contains(tableName))
+        m_generations.insert(tableName, 0);
+    return m_generations.value(tableName);
+}
+
+void ResultCache::insert(const QString &tableName, const QString &key, const Entry &entry, int generation, int cost)
+{
+    if (cost < 0) {
+        cost = 0;
+        foreach (const QVariant &item, entry.items)
+            cost += estimateSize(item);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (m_generations.value(tableName) != generation)
+        return;
+
+    // a very big result set would remove all other entries
+    if (cost > m_cache.maxCost() / 4)
+        return;
+
+    m_cache.insert(key, new Entry(entry), cost);
+    m_tableKeys[tableName].insert(key);
+}
+
+void ResultCache::invalidate(const QString &tableName)
+{
+    QMutexLocker locker(&m_mutex);
+    invalidateTable(tableName);
+}
+
+void ResultCache::invalidateQuery(const QString &sql)
+{
+    QRegExp readStatement(QStringLiteral("^\\s*(SELECT|PRAGMA|EXPLAIN|BEGIN|COMMIT|END|ROLLBACK|SAVEPOINT|RELEASE)\\b.*"), Qt::CaseInsensitive);
+    if (readStatement.exactMatch(sql))
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    QRegExp tableName;
+    tableName.setCaseSensitivity(Qt::CaseInsensitive);
+    foreach (const QString &table, m_generations.keys()) {
+        tableName.setPattern(QStringLiteral("\\b") + QRegExp::escape(table) + QStringLiteral("\\b"));
+        if (tableName.indexIn(sql) != -1)
+            invalidateTable(table);
+    }
+}
+
+void ResultCache::invalidateTable(const QString &tableName)
+{
+    ++m_generations[tableName];
+    foreach (const QString &key, m_tableKeys.take(tableName))
+        m_cache.remove(key);
+}
+
+void ResultCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, int>::iterator i = m_generations.begin();
+    for (; i != m_generations.end(); ++i)
+        ++i.value();
+    m_tableKeys.clear();
+    m_cache.clear();
+}
+
+QVariantMap ResultCache::stats()
+{
+    QMutexLocker locker(&m_mutex);
+    QVariantMap stats;
+    stats.insert(QStringLiteral("hits"), m_hits);
+    stats.insert(QStringLiteral("misses"), m_misses);
+    stats.insert(QStringLiteral("entries"), m_cache.size());
+    stats.insert(QStringLiteral("size"), m_cache.totalCost());
+    stats.insert(QStringLiteral("maxSize"), m_cache.maxCost());
+    return stats;
+}
+
+int ResultCache::estimateSize(const QVariant &value)
+{
+    // the QVariant size, plus the data allocated by strings, byte arrays, maps and lists
+    int size = sizeof(QVariant);
+    switch (value.userType()) {
+    case QMetaType::QString:
+        size += value.toString().size() * 2;
+        break;
+    case QMetaType::QByteArray:
+        size += value.toByteArray().size();
+        break;
+    case QMetaType::QVariantList: {
+        const QVariantList list(value.toList());
+        foreach (const QVariant &item, list)
+            size += estimateSize(item);
+        break;
+    }
+    case QMetaType::QVariantMap: {
+        const QVariantMap map(value.toMap());
+        QVariantMap::const_iterator i = map.constBegin();
+        for (; i != map.constEnd(); ++i)
+            size += i.key().size() * 2 + estimateSize(i.value());
+        break;
+    }
+    default:
+        break;
+    }
+    return size;
+}
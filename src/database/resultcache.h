@@ -0,0 +1,187 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QVariant>
+
+/**
+ * @brief The ResultCache class
+ * Keeps the result sets of the select queries in memory, so the same selection (the same table, query and bound values)
+ * is returned without execute the query again. Each entry is saved with a key created by Database::resultCacheKey
+ * and is removed when the table is changed: by the Database write methods (insert, update, remove...), by a commit or rollback
+ * of a transaction with changes in the table, and by a query executed with Database::queryExec that contains the table name.
+ * The entries cost is the estimated memory size of the rows and the least recently used entries are removed
+ * when the cache is bigger than 'maxSize' bytes.
+ * The object is created by Database and can be used by any thread.
+ */
+class ResultCache
+{
+public:
+    /**
+     * @brief The Entry struct
+     * Keeps a cached result set
+     */
+    struct Entry
+    {
+        /**
+         * @brief items
+         * The rows as a list of QVariantMap with column_name -> value
+         */
+        QVariantList items;
+
+        /**
+         * @brief previous
+         * The previous page token, if the selection uses keyset pagination
+         */
+        QString previous;
+
+        /**
+         * @brief next
+         * The next page token, if the selection uses keyset pagination
+         */
+        QString next;
+    };
+
+    /**
+     * @brief ResultCache
+     * @param maxSize int the max memory size in bytes. Zero disable the cache
+     */
+    explicit ResultCache(int maxSize = 4194304);
+
+    /**
+     * @brief isEnabled
+     * Return true if the max size is greater than zero
+     * @return bool
+     */
+    bool isEnabled();
+
+    /**
+     * @brief maxSize
+     * Return the max memory size in bytes
+     * @return int
+     */
+    int maxSize();
+
+    /**
+     * @brief setMaxSize
+     * Set the max memory size in bytes, removing the least recently used entries if needed. Zero disable the cache.
+     * @param maxSize int
+     */
+    void setMaxSize(int maxSize);
+
+    /**
+     * @brief find
+     * Search the 'key' in the cache. If found, copy the entry to 'entry' (the lists are implicitly shared).
+     * @param key QString the entry key
+     * @param entry Entry* the entry to fill
+     * @return bool true if the key was found
+     */
+    bool find(const QString &key, Entry *entry);
+
+    /**
+     * @brief generation
+     * Return the number of invalidations of 'tableName'. The caller save the generation before execute the query,
+     * and pass it to insert, to not cache a result set read before a table change.
+     * @param tableName QString
+     * @return int
+     */
+    int generation(const QString &tableName);
+
+    /**
+     * @brief insert
+     * Add the 'entry' to the cache, if the table was not changed after 'generation' and the entry is not bigger than a quarter of the cache.
+     * @param tableName QString the selected table
+     * @param key QString the entry key
+     * @param entry Entry the result set
+     * @param generation int the table generation before execute the query
+     * @param cost int the estimated size of the entry items, if already known. Otherwise, is calculated with estimateSize
+     */
+    void insert(const QString &tableName, const QString &key, const Entry &entry, int generation, int cost = -1);
+
+    /**
+     * @brief invalidate
+     * Remove all entries of 'tableName'
+     * @param tableName QString
+     */
+    void invalidate(const QString &tableName);
+
+    /**
+     * @brief invalidateQuery
+     * Remove the entries of the tables written by 'sql'. The read statements (SELECT, PRAGMA...) and the transaction
+     * statements are ignored, and the other statements invalidate each known table that is in the statement.
+     * @param sql QString a executed statement
+     */
+    void invalidateQuery(const QString &sql);
+
+    /**
+     * @brief clear
+     * Remove all entries
+     */
+    void clear();
+
+    /**
+     * @brief stats
+     * Return a map with the cache counters:
+     * "hits", "misses", "entries", "size" (the estimated bytes) and "maxSize"
+     * @return QVariantMap
+     */
+    QVariantMap stats();
+
+    /**
+     * @brief estimateSize
+     * Return the approximated memory size of 'value' in bytes, including the maps and lists values
+     * @param value QVariant
+     * @return int
+     */
+    static int estimateSize(const QVariant &value);
+
+private:
+    /**
+     * @brief invalidateTable
+     * Remove all entries of 'tableName'. The caller needs to lock m_mutex.
+     * @param tableName QString
+     */
+    void invalidateTable(const QString &tableName);
+
+    /**
+     * @brief m_cache
+     * The entries by key, with the estimated size as cost
+     */
+    QCache<QString, Entry> m_cache;
+
+    /**
+     * @brief m_tableKeys
+     * The keys of the entries of each table. The keys removed by the QCache (to free memory) are removed from the set on invalidate.
+     */
+    QHash<QString, QSet<QString> > m_tableKeys;
+
+    /**
+     * @brief m_generations
+     * The number of invalidations of each table
+     */
+    QHash<QString, int> m_generations;
+
+    /**
+     * @brief m_hits
+     * The number of find calls that found the key
+     */
+    int m_hits;
+
+    /**
+     * @brief m_misses
+     * The number of find calls that does not found the key
+     */
+    int m_misses;
+
+    /**
+     * @brief m_mutex
+     * Protect the members, since the cache is used by the GUI thread and the select workers
+     */
+    QMutex m_mutex;
+};
+
+#endif // RESULTCACHE_H
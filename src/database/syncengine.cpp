@@ -0,0 +1,165 @@
+#include "syncengine.h"
+#include "database.h"
+#include "queryexecutor.h"
+#include "syncpagewriter.h"
+#include "../core/utils.h"
+#include "../network/requesthttp.h"
+
+SyncEngine::SyncEngine(QObject *parent) : QObject(parent)
+  ,m_database(Database::instance())
+  ,m_request(new RequestHttp(this))
+  ,m_pkColumn(QStringLiteral("id"))
+  ,m_updatedAtColumn(QStringLiteral("updated_at"))
+  ,m_deletedColumn(QStringLiteral("deleted"))
+  ,m_itemsKey(QStringLiteral("items"))
+  ,m_pageSize(200)
+  ,m_isRunning(false)
+  ,m_isCanceled(false)
+  ,m_pages(0)
+  ,m_upserted(0)
+  ,m_removed(0)
+  ,m_failed(0)
+{
+    // the RequestHttp loads the base url from config.json only in the first instance
+    m_request->setBaseUrl(Utils::instance()->readFile(QStringLiteral(":/config.json")).toMap().value(QStringLiteral("restService")).toMap().value(QStringLiteral("baseUrl")).toByteArray());
+
+    connect(m_request, &RequestHttp::finished, this, &SyncEngine::onFinished);
+    connect(m_request, &RequestHttp::error, this, [this](int statusCode, const QVariant &message) {
+        if (m_isRunning)
+            finish(QString(QStringLiteral("%1 (%2)")).arg(message.toString()).arg(statusCode));
+    });
+}
+
+bool SyncEngine::isRunning() const
+{
+    return m_isRunning;
+}
+
+bool SyncEngine::sync()
+{
+    if (m_isRunning || m_tableName.isEmpty() || m_endpoint.isEmpty())
+        return false;
+
+    m_pages = 0;
+    m_upserted = 0;
+    m_removed = 0;
+    m_failed = 0;
+    m_isCanceled = false;
+    setRunning(true);
+
+    m_columns = m_database->tableColumns(m_tableName);
+    m_cborColumns = m_database->cborColumns(m_tableName);
+    if (m_columns.isEmpty()) {
+        finish(QStringLiteral("The table '") + m_tableName + QStringLiteral("' does not exists!"));
+        return true;
+    }
+
+    QVariantMap state(m_database->syncState(m_tableName));
+    m_watermark = state.value(QStringLiteral("watermark")).toString();
+    m_lastId = state.value(QStringLiteral("lastId")).toString();
+    requestPage();
+    return true;
+}
+
+void SyncEngine::cancel()
+{
+    if (m_isRunning)
+        m_isCanceled = true;
+}
+
+void SyncEngine::reset()
+{
+    if (!m_tableName.isEmpty())
+        m_database->setSyncState(m_tableName, QVariant());
+}
+
+QString SyncEngine::watermark()
+{
+    if (m_tableName.isEmpty())
+        return QString();
+    return m_database->syncState(m_tableName).value(QStringLiteral("watermark")).toString();
+}
+
+void SyncEngine::requestPage()
+{
+    QVariantMap args(m_queryArgs);
+    args.insert(QStringLiteral("limit"), m_pageSize);
+    if (!m_watermark.isEmpty()) {
+        args.insert(QStringLiteral("since"), m_watermark);
+        args.insert(QStringLiteral("after"), m_lastId);
+    }
+    m_request->get(m_endpoint, args, m_headers);
+}
+
+void SyncEngine::onFinished(int statusCode, const QVariant &response)
+{
+    // the response of a canceled or failed sync
+    if (!m_isRunning)
+        return;
+
+    if (statusCode < 200 || statusCode >= 300) {
+        finish(QString(QStringLiteral("The server returns the status code %1")).arg(statusCode));
+        return;
+    }
+
+    QVariantList records(response.userType() == QMetaType::QVariantList ? response.toList() : response.toMap().value(m_itemsKey).toList());
+    savePage(records);
+}
+
+void SyncEngine::savePage(const QVariantList &records)
+{
+    // the page is saved in the QueryExecutor thread pool, and the result is received in the GUI thread
+    auto *writer = new SyncPageWriter(m_tableName, m_columns, m_cborColumns, records);
+    writer->setKeys(m_pkColumn, m_updatedAtColumn, m_deletedColumn);
+    writer->setWatermark(m_watermark, m_lastId);
+    int pageRows = records.size();
+    connect(writer, &SyncPageWriter::pageSaved, writer, &QObject::deleteLater);
+    connect(writer, &SyncPageWriter::pageSaved, this, [this, pageRows](const QVariantMap &result) {
+        onPageSaved(result, pageRows);
+    });
+    QueryExecutor::instance()->start(writer);
+}
+
+void SyncEngine::onPageSaved(const QVariantMap &result, int pageRows)
+{
+    m_failed += result.value(QStringLiteral("failed")).toInt();
+    // the page was rolled back, so the watermark is kept and the next sync request the page again
+    QString error(result.value(QStringLiteral("error")).toString());
+    if (!error.isEmpty()) {
+        finish(error);
+        return;
+    }
+
+    m_watermark = result.value(QStringLiteral("watermark")).toString();
+    m_lastId = result.value(QStringLiteral("lastId")).toString();
+    m_upserted += result.value(QStringLiteral("upserted")).toInt();
+    m_removed += result.value(QStringLiteral("removed")).toInt();
+    ++m_pages;
+    emit progress(m_pages, m_upserted, m_removed);
+
+    if (m_isCanceled || pageRows < m_pageSize)
+        finish();
+    else
+        requestPage();
+}
+
+void SyncEngine::finish(const QString &error)
+{
+    QVariantMap result;
+    result.insert(QStringLiteral("pages"), m_pages);
+    result.insert(QStringLiteral("upserted"), m_upserted);
+    result.insert(QStringLiteral("removed"), m_removed);
+    result.insert(QStringLiteral("failed"), m_failed);
+    result.insert(QStringLiteral("watermark"), m_watermark);
+    result.insert(QStringLiteral("canceled"), m_isCanceled);
+    result.insert(QStringLiteral("error"), error);
+
+    setRunning(false);
+    emit syncFinished(result);
+}
+
+void SyncEngine::setRunning(bool running)
+{
+    m_isRunning = running;
+    emit runningChanged(m_isRunning);
+}
@@ -0,0 +1,201 @@
+#ifndef SYNCENGINE_H
+#define SYNCENGINE_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVariant>
+
+class Database;
+class RequestHttp;
+
+/**
+ * @brief The SyncEngine class
+ * @extends QObject
+ * Keeps a plugin table synchronized with a webservice list endpoint, downloading only the rows changed after the last sync.
+ * The engine is configured in QML with the table, the endpoint and the primary key and updated_at columns:
+ *   SyncEngine {
+ *       tableName: "products"
+ *       endpoint: "/products"
+ *       onSyncFinished: console.log(result.upserted, result.removed)
+ *   }
+ * and sync() request the pages with the RequestHttp (using the baseUrl and authorization of config.json):
+ *   GET /products?since=<watermark>&after=<lastId>&limit=<pageSize>
+ * The server needs to return the rows with (updated_at, id) greater than (since, after), ordered by updated_at and id,
+ * as a json array or as a object with the array in 'itemsKey'. The rows with 'deletedColumn' set to true are tombstones
+ * and are removed from the table, the others are upserted by the primary key. Each page is saved by a SyncPageWriter in the
+ * QueryExecutor thread pool, in a single transaction with the new watermark (see Database::setSyncState), so a interrupted
+ * sync continue from the last saved page. If some row cannot be saved, the page is rolled back and the sync finish with error.
+ * The pages are requested until the server returns less than 'pageSize' rows.
+ */
+class SyncEngine : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString tableName MEMBER m_tableName)
+    Q_PROPERTY(QByteArray endpoint MEMBER m_endpoint)
+    Q_PROPERTY(QString pkColumn MEMBER m_pkColumn)
+    Q_PROPERTY(QString updatedAtColumn MEMBER m_updatedAtColumn)
+    Q_PROPERTY(QString deletedColumn MEMBER m_deletedColumn)
+    Q_PROPERTY(QString itemsKey MEMBER m_itemsKey)
+    Q_PROPERTY(int pageSize MEMBER m_pageSize)
+    Q_PROPERTY(QVariantMap headers MEMBER m_headers)
+    Q_PROPERTY(QVariantMap queryArgs MEMBER m_queryArgs)
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+public:
+    /**
+     * @brief SyncEngine
+     * @param parent QObject* the parent of this object if exists
+     */
+    explicit SyncEngine(QObject *parent = nullptr);
+
+    /**
+     * @brief isRunning
+     * Return true while the pages are requested and saved
+     * @return bool
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief sync
+     * Start to request the rows changed after the saved watermark. If the table was never synchronized, all rows are requested.
+     * @return bool false if the sync is already running or the table name or endpoint is not set
+     */
+    Q_INVOKABLE bool sync();
+
+    /**
+     * @brief cancel
+     * Stop the sync after the current page. The saved pages are kept and the next sync continue from the last page.
+     */
+    Q_INVOKABLE void cancel();
+
+    /**
+     * @brief reset
+     * Remove the saved watermark, so the next sync request all rows again.
+     */
+    Q_INVOKABLE void reset();
+
+    /**
+     * @brief watermark
+     * Return the updated_at value of the last synchronized row, or a empty string if the table was never synchronized.
+     * @return QString
+     */
+    Q_INVOKABLE QString watermark();
+
+signals:
+    /**
+     * @brief runningChanged
+     * This signal will be emitted when the sync starts and finishes.
+     * @param running bool
+     */
+    void runningChanged(bool running);
+
+    /**
+     * @brief progress
+     * This signal will be emitted after each page is saved.
+     * @param pages int the number of saved pages
+     * @param upserted int the number of inserted or updated rows
+     * @param removed int the number of removed rows
+     */
+    void progress(int pages, int upserted, int removed);
+
+    /**
+     * @brief syncFinished
+     * This signal will be emitted at the end of the sync, even if the sync fails or is canceled.
+     * @param result QVariantMap a map with:
+     * "pages"     -> integer the number of saved pages
+     * "upserted"  -> integer the number of inserted or updated rows
+     * "removed"   -> integer the number of rows removed by tombstones
+     * "failed"    -> integer the number of rows without primary key, that are ignored
+     * "watermark" -> QString the saved watermark
+     * "canceled"  -> bool true if the sync was canceled
+     * "error"     -> QString the error message, or a empty string
+     */
+    void syncFinished(const QVariantMap &result);
+
+private:
+    /**
+     * @brief requestPage
+     * Request the next page, with the rows changed after m_watermark and m_lastId
+     */
+    void requestPage();
+
+    /**
+     * @brief onFinished
+     * Handle the RequestHttp::finished signal: save the page rows and request the next page, or finish the sync
+     * @param statusCode int the http status code
+     * @param response QVariant the json array, or a map with the array in m_itemsKey
+     */
+    void onFinished(int statusCode, const QVariant &response);
+
+    /**
+     * @brief savePage
+     * Start a SyncPageWriter in the QueryExecutor thread pool to upsert the page rows and remove the tombstones,
+     * saving the new watermark in the same transaction. The result is handled by onPageSaved.
+     * @param records QVariantList the page rows, as QVariantMap
+     */
+    void savePage(const QVariantList &records);
+
+    /**
+     * @brief onPageSaved
+     * Handle the SyncPageWriter::pageSaved signal: update the watermark and request the next page,
+     * or finish the sync if the page was rolled back, canceled or is the last page
+     * @param result QVariantMap the page result (see SyncPageWriter::pageSaved)
+     * @param pageRows int the number of rows in the page
+     */
+    void onPageSaved(const QVariantMap &result, int pageRows);
+
+    /**
+     * @brief finish
+     * Stop the sync and emit the syncFinished signal
+     * @param error QString the error message, or a empty string
+     */
+    void finish(const QString &error = QString());
+
+    /**
+     * @brief setRunning
+     * Set m_isRunning and emit the runningChanged signal
+     * @param running bool
+     */
+    void setRunning(bool running);
+
+    Database *m_database;
+    RequestHttp *m_request;
+
+    QString m_tableName;
+    QByteArray m_endpoint;
+    QString m_pkColumn;
+    QString m_updatedAtColumn;
+
+    /**
+     * @brief m_deletedColumn
+     * The field of the tombstones, like {"id": 12, "updated_at": "...", "deleted": true}. The default is "deleted".
+     */
+    QString m_deletedColumn;
+
+    /**
+     * @brief m_itemsKey
+     * The key of the rows array when the server returns a object. The default is "items".
+     */
+    QString m_itemsKey;
+    int m_pageSize;
+    QVariantMap m_headers;
+
+    /**
+     * @brief m_queryArgs
+     * The extra url arguments sent in each page request
+     */
+    QVariantMap m_queryArgs;
+
+    QStringList m_columns;
+    QStringList m_cborColumns;
+    QString m_watermark;
+    QString m_lastId;
+
+    bool m_isRunning;
+    bool m_isCanceled;
+    int m_pages;
+    int m_upserted;
+    int m_removed;
+    int m_failed;
+};
+
+#endif // SYNCENGINE_H
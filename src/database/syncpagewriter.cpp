@@ -0,0 +1,124 @@
+#include "syncpagewriter.h"
+#include "database.h"
+
+#include <QJsonDocument>
+
+SyncPageWriter::SyncPageWriter(const QString &tableName, const QStringList &columns, const QStringList &cborColumns, const QVariantList &records, QObject *parent) :
+    QObject(parent), m_tableName(tableName), m_columns(columns), m_cborColumns(cborColumns), m_records(records)
+{
+    m_database = Database::instance();
+    setAutoDelete(false);
+}
+
+void SyncPageWriter::setKeys(const QString &pkColumn, const QString &updatedAtColumn, const QString &deletedColumn)
+{
+    m_pkColumn = pkColumn;
+    m_updatedAtColumn = updatedAtColumn;
+    m_deletedColumn = deletedColumn;
+}
+
+void SyncPageWriter::setWatermark(const QString &watermark, const QString &lastId)
+{
+    m_watermark = watermark;
+    m_lastId = lastId;
+}
+
+void SyncPageWriter::run()
+{
+    int upserted = 0;
+    int removed = 0;
+    int failed = 0;
+    QString error;
+    QString watermark(m_watermark);
+    QString lastId(m_lastId);
+
+    // the GUI thread and the WriteQueue can commit while the page is saved, so the page waits the write lock in the begin
+    if (!m_records.isEmpty() && !m_database->transaction(true))
+        error = QStringLiteral("Fatal error on try begin the sync page transaction: ") + m_database->lastError();
+
+    QVariant id;
+    QVariantMap record;
+    QVariantMap where;
+    QStringList conflictColumns(m_pkColumn);
+    foreach (const QVariant &item, m_records) {
+        if (!error.isEmpty())
+            break;
+        record = item.toMap();
+        id = record.value(m_pkColumn);
+        // a row without primary key can never be saved, so is ignored and the sync continue
+        if (id.isNull()) {
+            ++failed;
+            continue;
+        }
+
+        if (!m_deletedColumn.isEmpty() && record.value(m_deletedColumn).toBool()) {
+            where.insert(m_pkColumn, id);
+            removed += m_database->remove(m_tableName, where);
+            where.clear();
+        } else if (m_database->upsert(m_tableName, tableRow(record), conflictColumns) > 0) {
+            ++upserted;
+        } else {
+            // the watermark cannot pass a row that was not saved, or the row is never requested again
+            error = QStringLiteral("Fatal error on try save the sync row '") + watermarkString(id) + QStringLiteral("': ") + m_database->lastError();
+            break;
+        }
+
+        // the rows are ordered by updated_at and id, so the last row is the new watermark
+        if (record.contains(m_updatedAtColumn))
+            watermark = watermarkString(record.value(m_updatedAtColumn));
+        lastId = watermarkString(id);
+    }
+
+    if (!m_records.isEmpty() && error.isEmpty() && (!m_database->setSyncState(m_tableName, watermark, lastId) || !m_database->commit()))
+        error = QStringLiteral("Fatal error on try save the sync page: ") + m_database->lastError();
+
+    QVariantMap result;
+    if (!m_records.isEmpty() && !error.isEmpty()) {
+        m_database->rollback();
+        upserted = 0;
+        removed = 0;
+        watermark = m_watermark;
+        lastId = m_lastId;
+    }
+    result.insert(QStringLiteral("upserted"), upserted);
+    result.insert(QStringLiteral("removed"), removed);
+    result.insert(QStringLiteral("failed"), failed);
+    result.insert(QStringLiteral("watermark"), watermark);
+    result.insert(QStringLiteral("lastId"), lastId);
+    result.insert(QStringLiteral("error"), error);
+    emit pageSaved(result);
+}
+
+QVariantMap SyncPageWriter::tableRow(const QVariantMap &record) const
+{
+    int type = 0;
+    QVariantMap row;
+    QVariantMap::const_iterator i = record.constBegin();
+    for (; i != record.constEnd(); ++i) {
+        if (!m_columns.contains(i.key()))
+            continue;
+        type = i.value().userType();
+        if (type == QMetaType::QVariantMap || type == QMetaType::QVariantList) {
+            QByteArray cbor;
+            if (m_cborColumns.contains(i.key()))
+                cbor = Database::encodeCbor(i.value());
+            if (cbor.isEmpty())
+                row.insert(i.key(), QString::fromUtf8(QJsonDocument::fromVariant(i.value()).toJson(QJsonDocument::Compact)));
+            else
+                row.insert(i.key(), cbor);
+        } else {
+            row.insert(i.key(), i.value());
+        }
+    }
+    return row;
+}
+
+QString SyncPageWriter::watermarkString(const QVariant &value)
+{
+    if (value.userType() == QMetaType::Double) {
+        double number = value.toDouble();
+        if (number == static_cast<qint64>(number))
+            return QString::number(static_cast<qint64>(number));
+    }
+    return value.toString();
+}
@@ -0,0 +1,108 @@
+#ifndef SYNCPAGEWRITER_H
+#define SYNCPAGEWRITER_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QStringList>
+#include <QVariant>
+
+class Database;
+
+/**
+ * @brief The SyncPageWriter class
+ * Save a page downloaded by SyncEngine in a single transaction: upsert the rows, remove the tombstones and save the new
+ * watermark (see Database::setSyncState). If some row cannot be saved, the page is rolled back and the watermark is not
+ * changed, so the next sync request the same rows again.
+ * The object is a QRunnable executed by the QueryExecutor thread pool, so the GUI thread never wait for the disk,
+ * and is not deleted by the pool. The 'pageSaved' signal is always sent at the end of the execution and can be used
+ * to delete the object.
+ */
+class SyncPageWriter : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief SyncPageWriter
+     * @param tableName QString the synchronized table
+     * @param columns QStringList the table columns. The other record fields are not saved.
+     * @param cborColumns QStringList the columns saved as CBOR (see Database::setCborColumns)
+     * @param records QVariantList the page rows, as QVariantMap
+     * @param parent QObject* the object parent
+     */
+    explicit SyncPageWriter(const QString &tableName, const QStringList &columns, const QStringList &cborColumns, const QVariantList &records, QObject *parent = nullptr);
+
+    /**
+     * @brief setKeys
+     * Set the record fields with the primary key, the updated_at value and the tombstone flag
+     * @param pkColumn QString
+     * @param updatedAtColumn QString
+     * @param deletedColumn QString
+     */
+    void setKeys(const QString &pkColumn, const QString &updatedAtColumn, const QString &deletedColumn);
+
+    /**
+     * @brief setWatermark
+     * Set the watermark saved by the previous page, kept if the page has no rows
+     * @param watermark QString
+     * @param lastId QString
+     */
+    void setWatermark(const QString &watermark, const QString &lastId);
+
+    /**
+     * @brief run
+     * @overload
+     * The start point for the task, called by some thread from the QueryExecutor thread pool.
+     * @return void
+     */
+    void run() override;
+
+signals:
+    /**
+     * @brief pageSaved
+     * This signal will be emitted at the end of run(), even if the page fails.
+     * @param result QVariantMap a map with:
+     * "upserted"  -> integer the number of inserted or updated rows
+     * "removed"   -> integer the number of rows removed by tombstones
+     * "failed"    -> integer the number of rows without primary key, that are ignored
+     * "watermark" -> QString the new watermark
+     * "lastId"    -> QString the primary key of the last row
+     * "error"     -> QString the error message if the page was rolled back, or a empty string
+     */
+    void pageSaved(const QVariantMap &result);
+
+private:
+    /**
+     * @brief tableRow
+     * Return the 'record' values of the table columns. The objects and arrays are saved as json, or as CBOR in the CBOR columns.
+     * @param record QVariantMap
+     * @return QVariantMap
+     */
+    QVariantMap tableRow(const QVariantMap &record) const;
+
+    /**
+     * @brief watermarkString
+     * Return the updated_at value as string. The integer timestamps parsed from json as double
+     * are converted without the exponent notation.
+     * @param value QVariant
+     * @return QString
+     */
+    static QString watermarkString(const QVariant &value);
+
+    QString m_tableName;
+    QStringList m_columns;
+    QStringList m_cborColumns;
+    QVariantList m_records;
+    QString m_pkColumn;
+    QString m_updatedAtColumn;
+    QString m_deletedColumn;
+    QString m_watermark;
+    QString m_lastId;
+
+    /**
+     * @brief m_database
+     * A pointer to Database object where save the page.
+     */
+    Database *m_database;
+};
+
+#endif // SYNCPAGEWRITER_H
@@ -0,0 +1,152 @@
+#include "tablemodel.h"
+#include "database.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+TableModel::TableModel(QObject *parent) : QAbstractListModel(parent)
+  ,m_hasMore(false)
+  ,m_fetchSize(50)
+  ,m_database(Database::instance())
+{
+}
+
+void TableModel::setTable(const QString &tableName, const QStringList &columns, const QStringList &jsonColumns)
+{
+    beginResetModel();
+    m_rows.clear();
+    m_hasMore = false;
+    m_tableName = tableName;
+    m_columns = columns;
+    m_jsonColumns.clear();
+    foreach (const QString &column, jsonColumns) {
+        int index = m_columns.indexOf(column);
+        if (index > -1)
+            m_jsonColumns << index;
+    }
+    endResetModel();
+}
+
+void TableModel::select(const QVariantMap &where, const QVariantMap &args)
+{
+    beginResetModel();
+    m_rows.clear();
+    m_where = where;
+    m_args = args;
+    m_args.remove(QStringLiteral("before"));
+    m_args.remove(QStringLiteral("offset"));
+    // a empty token select the first page
+    m_args.insert(QStringLiteral("after"), QString());
+    m_hasMore = !m_tableName.isEmpty();
+    endResetModel();
+}
+
+QVariantMap TableModel::get(int row) const
+{
+    QVariantMap map;
+    if (row < 0 || row >= m_rows.size())
+        return map;
+    int totalColumns = m_columns.size();
+    for (int i = 0; i < totalColumns; ++i)
+        map.insert(m_columns.at(i), data(index(row), Qt::UserRole + 1 + i));
+    return map;
+}
+
+int TableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant TableModel::data(const QModelIndex &index, int role) const
+{
+    int column = role - Qt::UserRole - 1;
+    if (!index.isValid() || index.row() >= m_rows.size() || column < 0 || column >= m_columns.size())
+        return QVariant();
+
+    // the json columns are parsed and the CBOR values decoded only when are read by the view
+    const QVariant &value = m_rows.at(index.row()).at(column);
+    if (!m_jsonColumns.contains(column) || !Database::isJsonDocument(value.toByteArray()))
+        return Database::decodeValue(value);
+
+    QJsonParseError jsonParseError;
+    QJsonDocument json(QJsonDocument::fromJson(value.toByteArray(), &jsonParseError));
+    if (jsonParseError.error == QJsonParseError::NoError) {
+        if (json.isObject() && !json.isEmpty())
+            return json.object().toVariantMap();
+        else if (json.isArray() && !json.isEmpty())
+            return json.array().toVariantList();
+    }
+    return value;
+}
+
+QHash<int, QByteArray> TableModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    int totalColumns = m_columns.size();
+    for (int i = 0; i < totalColumns; ++i)
+        roles.insert(Qt::UserRole + 1 + i, m_columns.at(i).toUtf8());
+    return roles;
+}
+
+bool TableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_hasMore;
+}
+
+void TableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || !m_hasMore)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    m_args.insert(QStringLiteral("limit"), m_fetchSize);
+    QSqlQuery *sqlQuery = m_database->selectCursor(m_tableName, m_where, m_args);
+    if (!sqlQuery) {
+        m_hasMore = false;
+        return;
+    }
+
+    // map each statement field to the model column
+    QSqlRecord record(sqlQuery->record());
+    int totalColumns = m_columns.size();
+    int pkIndex = record.indexOf(m_database->pkColumn(m_args));
+    QVector<int> fieldIndexes(totalColumns);
+    for (int i = 0; i < totalColumns; ++i)
+        fieldIndexes[i] = record.indexOf(m_columns.at(i));
+
+    int i = 0;
+    QVariant lastPk;
+    QVector<QVariant> row(totalColumns);
+    QVector<QVector<QVariant>> rows;
+    rows.reserve(m_fetchSize);
+    while (sqlQuery->next()) {
+        for (i = 0; i < totalColumns; ++i)
+            row[i] = fieldIndexes.at(i) > -1 ? sqlQuery->value(fieldIndexes.at(i)) : QVariant();
+        if (pkIndex > -1)
+            lastPk = sqlQuery->value(pkIndex);
+        rows << row;
+    }
+    m_database->profileQuery(sqlQuery, timer.nsecsElapsed(), rows.size());
+
+    // reset the statement to release the read snapshot, the next page is a new query
+    sqlQuery->finish();
+
+    // a short page is the last page, and the next page starts after the last primary key
+    m_hasMore = rows.size() == m_fetchSize && lastPk.isValid();
+    if (m_hasMore)
+        m_args.insert(QStringLiteral("after"), Database::encodePageToken(lastPk));
+
+    if (rows.isEmpty())
+        return;
+
+    int first = m_rows.size();
+    beginInsertRows(QModelIndex(), first, first + rows.size() - 1);
+    m_rows << rows;
+    endInsertRows();
+}
@@ -0,0 +1,173 @@
+#ifndef TABLEMODEL_H
+#define TABLEMODEL_H
+
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+class Database;
+
+/**
+ * @brief The TableModel class
+ * @extends QAbstractListModel
+ * This class expose a database table selection as a list model to QML ListView, with one role for each table column.
+ * Instead of copy the whole result set to a QML ListModel, the rows are read on demand using keyset pagination:
+ * the ListView calls canFetchMore/fetchMore when needs to show more rows, and the model select the next 'fetchSize' rows
+ * after the last primary key read ('pk > last LIMIT fetchSize', see Database::select "after" argument). Each page statement
+ * is reset after read, so the model never keeps a read transaction open in the GUI thread connection (that would pin a
+ * old WAL snapshot, blocking the checkpoints and the writes of this connection). The rows are ordered by the primary key.
+ * The rows are kept as lists of values (without the columns names) and the json columns are parsed only when are read.
+ * This object is created by DatabaseComponent and can be accessed by the 'model' property. Example:
+ *
+ * ListView {
+ *    model: database.model
+ *    delegate: Text { text: name }
+ * }
+ *
+ * Database {
+ *    id: database
+ *    tableName: "messages"
+ *    Component.onCompleted: selectModel({}, {"order": "desc"})
+ * }
+ */
+class TableModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int fetchSize MEMBER m_fetchSize)
+public:
+    /**
+     * @brief TableModel
+     * @param parent QObject* the parent of this object if exists
+     */
+    explicit TableModel(QObject *parent = nullptr);
+
+    /**
+     * @brief setTable
+     * Set the table used by the model and the table columns, used to create the model roles.
+     * The roles needs to be defined before the model is set to a ListView, so this method reset the model.
+     * @param tableName QString the table name
+     * @param columns QStringList the table columns names
+     * @param jsonColumns QStringList the columns saved as serialized json, parsed to object or array when read
+     */
+    void setTable(const QString &tableName, const QStringList &columns, const QStringList &jsonColumns);
+
+    /**
+     * @brief select
+     * Reset the model and keep 'where' and 'args' (the same arguments of Database::select) to select the pages
+     * when the view calls fetchMore. The "pkColumn" (default is "id") and "order" arguments set the rows order,
+     * "orderby", "offset" and "limit" are ignored.
+     * @param where QVariantMap
+     * @param args QVariantMap
+     */
+    void select(const QVariantMap &where, const QVariantMap &args);
+
+    /**
+     * @brief get
+     * Return the row as a map with column_name->value, like the QML ListModel::get
+     * @param row int the row index
+     * @return QVariantMap a empty map if row is invalid
+     */
+    Q_INVOKABLE QVariantMap get(int row) const;
+
+    /**
+     * @brief rowCount
+     * @overload
+     * Return the number of rows already read
+     * @param parent QModelIndex
+     * @return int
+     */
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    /**
+     * @brief data
+     * @overload
+     * Return the value of the column (role) for the row in index
+     * @param index QModelIndex
+     * @param role int the column role
+     * @return QVariant
+     */
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    /**
+     * @brief roleNames
+     * @overload
+     * Return the table columns names as the model roles
+     * @return QHash<int, QByteArray>
+     */
+    QHash<int, QByteArray> roleNames() const override;
+
+    /**
+     * @brief canFetchMore
+     * @overload
+     * Return true until a page with less than 'fetchSize' rows is read
+     * @param parent QModelIndex
+     * @return bool
+     */
+    bool canFetchMore(const QModelIndex &parent) const override;
+
+    /**
+     * @brief fetchMore
+     * @overload
+     * Select the next 'fetchSize' rows after the last read primary key and append in the model
+     * @param parent QModelIndex
+     */
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    /**
+     * @brief m_tableName
+     * The table name used by select
+     */
+    QString m_tableName;
+
+    /**
+     * @brief m_columns
+     * The table columns names, in the roles order
+     */
+    QStringList m_columns;
+
+    /**
+     * @brief m_jsonColumns
+     * The indexes (in m_columns) of the columns saved as serialized json
+     */
+    QVector<int> m_jsonColumns;
+
+    /**
+     * @brief m_rows
+     * The rows already read, each row with the values in the m_columns order
+     */
+    QVector<QVector<QVariant>> m_rows;
+
+    /**
+     * @brief m_where
+     * The filter of the selection, used by each page
+     */
+    QVariantMap m_where;
+
+    /**
+     * @brief m_args
+     * The select arguments of the selection, with the page size and the token of the next page
+     */
+    QVariantMap m_args;
+
+    /**
+     * @brief m_hasMore
+     * True until a page with less than m_fetchSize rows is read
+     */
+    bool m_hasMore;
+
+    /**
+     * @brief m_fetchSize
+     * The number of rows read in each fetchMore. The default is 50.
+     */
+    int m_fetchSize;
+
+    /**
+     * @brief m_database
+     * A pointer to Database object.
+     */
+    Database *m_database;
+};
+
+#endif // TABLEMODEL_H
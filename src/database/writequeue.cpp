@@ -0,0 +1,157 @@
+#include "writequeue.h"
+#include "database.h"
+#include "../core/utils.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+WriteQueue* WriteQueue::m_instance = nullptr;
+
+WriteQueue::WriteQueue(QObject *parent) : QThread(parent)
+  ,m_database(Database::instance())
+  ,m_counter(0)
+  ,m_flushInterval(50)
+  ,m_maxBatchRows(500)
+  ,m_flushRequested(false)
+  ,m_stopRequested(false)
+  ,m_isRunning(false)
+{
+    m_database->addDedicatedThread(this);
+
+    QVariantMap config(Utils::instance()->readFile(QStringLiteral(":/config.json")).toMap().value(QStringLiteral("database")).toMap());
+    if (config.value(QStringLiteral("write_flush_interval")).toInt() > 0)
+        m_flushInterval = config.value(QStringLiteral("write_flush_interval")).toInt();
+    if (config.value(QStringLiteral("write_batch_rows")).toInt() > 0)
+        m_maxBatchRows = config.value(QStringLiteral("write_batch_rows")).toInt();
+
+    // commit the pending writes before the application quit
+    if (QCoreApplication::instance())
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &WriteQueue::stop, Qt::DirectConnection);
+}
+
+WriteQueue *WriteQueue::instance()
+{
+    if (!WriteQueue::m_instance)
+        WriteQueue::m_instance = new WriteQueue;
+    return WriteQueue::m_instance;
+}
+
+int WriteQueue::enqueue(Write write)
+{
+    QMutexLocker locker(&m_mutex);
+    write.id = ++m_counter;
+    m_queue.enqueue(write);
+    m_stopRequested = false;
+    m_queueChanged.wakeOne();
+
+    // the run loop clears m_isRunning (with the mutex locked) before exit, so the write is never
+    // left in the queue of a exiting thread. The previous run can still be returning, so wait it
+    if (!m_isRunning) {
+        m_isRunning = true;
+        wait();
+        start();
+    }
+    return write.id;
+}
+
+void WriteQueue::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    m_flushRequested = true;
+    m_queueChanged.wakeOne();
+}
+
+void WriteQueue::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stopRequested = true;
+    m_flushRequested = true;
+    m_queueChanged.wakeOne();
+    locker.unlock();
+    wait();
+}
+
+QString WriteQueue::operationName(Operation operation)
+{
+    switch (operation) {
+    case Insert:
+        return QStringLiteral("insert");
+    case Update:
+        return QStringLiteral("update");
+    case Upsert:
+        return QStringLiteral("upsert");
+    case Remove:
+        return QStringLiteral("remove");
+    }
+    return QString();
+}
+
+void WriteQueue::run()
+{
+    int i = 0;
+    qint64 remaining = 0;
+    bool inTransaction = false;
+    bool rolledBack = false;
+    QList<Write> writes;
+    QList<int> results;
+    QElapsedTimer timer;
+
+    forever {
+        QMutexLocker locker(&m_mutex);
+        while (m_queue.isEmpty() && !m_stopRequested)
+            m_queueChanged.wait(&m_mutex);
+        if (m_queue.isEmpty()) {
+            m_isRunning = false;
+            break;
+        }
+
+        // wait for more writes to group in the same transaction, until the flush interval
+        // from the first write, or until the queue has the max number of rows
+        timer.start();
+        remaining = m_flushInterval;
+        while (!m_flushRequested && m_queue.size() < m_maxBatchRows && remaining > 0) {
+            m_queueChanged.wait(&m_mutex, static_cast<unsigned long>(remaining));
+            remaining = m_flushInterval - timer.elapsed();
+        }
+        m_flushRequested = m_stopRequested;
+
+        writes.clear();
+        while (!m_queue.isEmpty() && writes.size() < m_maxBatchRows)
+            writes << m_queue.dequeue();
+        locker.unlock();
+
+        // a write that fails is counted with zero result, and the others writes are committed
+        results.clear();
+        rolledBack = false;
+        // the first write can read before write (like the rowids of update and remove), so the lock is taken in the begin
+        inTransaction = m_database->transaction(true);
+        if (!inTransaction)
+            emit m_database->logMessage(QStringLiteral("Error on try begin the write queue transaction: ") + m_database->lastError());
+        foreach (const Write &write, writes)
+            results << execute(write);
+        if (inTransaction && !m_database->commit()) {
+            emit m_database->logMessage(QStringLiteral("Fatal error on try commit the write queue: ") + m_database->lastError());
+            m_database->rollback();
+            rolledBack = true;
+        }
+
+        for (i = 0; i < writes.size(); ++i)
+            emit writeFinished(writes.at(i).id, operationName(writes.at(i).operation), rolledBack ? 0 : results.at(i));
+    }
+}
+
+int WriteQueue::execute(const Write &write)
+{
+    switch (write.operation) {
+    case Insert:
+        return m_database->insert(write.tableName, write.data, true);
+    case Update:
+        return m_database->update(write.tableName, write.data, write.where);
+    case Upsert:
+        return m_database->upsert(write.tableName, write.data, write.conflictColumns);
+    case Remove:
+        return m_database->remove(write.tableName, write.where);
+    }
+    return 0;
+}
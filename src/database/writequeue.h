@@ -0,0 +1,239 @@
+#ifndef WRITEQUEUE_H
+#define WRITEQUEUE_H
+
+#include <QMutex>
+#include <QQueue>
+#include <QStringList>
+#include <QThread>
+#include <QVariant>
+#include <QWaitCondition>
+
+class Database;
+
+/**
+ * @brief The WriteQueue class
+ * @extends QThread
+ * This class implements a Singleton pattern and execute the database writes (insert, update, upsert and remove)
+ * in a dedicated writer thread, so the GUI thread never wait for the disk. The writes are put in a queue and
+ * the writer thread group the consecutive writes in a single transaction: the transaction is committed
+ * after 'flushInterval' milliseconds from the first queued write or when the queue has 'maxBatchRows' writes.
+ * The result of each write is sent by the 'writeFinished' signal, with the id returned by enqueue.
+ * The flush interval and the batch size can be set by "write_flush_interval" and "write_batch_rows"
+ * in the "database" object of config.json. The pending writes are committed when the application quit.
+ */
+class WriteQueue : public QThread
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief The Operation enum
+     * The write operations accepted by the queue. The Insert operation uses 'ON CONFLICT(pk) DO NOTHING',
+     * so a row with a existing primary key is not inserted and the result is zero.
+     */
+    enum Operation {
+        Insert,
+        Update,
+        Upsert,
+        Remove
+    };
+
+    /**
+     * @brief The Write struct
+     * Keeps the arguments of a queued write
+     */
+    struct Write
+    {
+        /**
+         * @brief id
+         * The write id, sent in the 'writeFinished' signal
+         */
+        int id;
+
+        /**
+         * @brief operation
+         * The write operation
+         */
+        Operation operation;
+
+        /**
+         * @brief tableName
+         * The table name where the write is executed
+         */
+        QString tableName;
+
+        /**
+         * @brief data
+         * The column_name -> value to insert, update or upsert
+         */
+        QVariantMap data;
+
+        /**
+         * @brief where
+         * The column_name -> value used as filter condition by update and remove
+         */
+        QVariantMap where;
+
+        /**
+         * @brief conflictColumns
+         * The conflict columns used by upsert. If empty, uses "id".
+         */
+        QStringList conflictColumns;
+    };
+
+private:
+    /**
+     * @brief WriteQueue
+     * The object construct
+     * @param parent QObject*
+     */
+    explicit WriteQueue(QObject *parent = nullptr);
+
+    /**
+     * @brief WriteQueue
+     * In singleton object, the copy constructor needs to be private
+     * @param other WriteQueue
+     */
+    WriteQueue(const WriteQueue &other);
+
+    /**
+     * @brief operator =
+     * In singleton object, the operator '=' needs to be private
+     */
+    void operator=(const WriteQueue &);
+
+public:
+    /**
+     * @brief instance
+     * Return the pointer to this object
+     * @return WriteQueue*
+     */
+    static WriteQueue *instance();
+
+    /**
+     * @brief enqueue
+     * Put the write in the queue and start the writer thread if is not running.
+     * The write.id is set by this method.
+     * @param write Write the write arguments
+     * @return int the write id, sent in the 'writeFinished' signal
+     */
+    int enqueue(Write write);
+
+    /**
+     * @brief flush
+     * Request the writer thread to commit the queued writes now, without wait the flush interval.
+     */
+    void flush();
+
+    /**
+     * @brief stop
+     * Commit the queued writes and stop the writer thread. The caller wait until the thread finish.
+     * Is called when the application is about to quit.
+     */
+    void stop();
+
+    /**
+     * @brief operationName
+     * Return the operation name, like "insert" or "remove"
+     * @param operation Operation
+     * @return QString
+     */
+    static QString operationName(Operation operation);
+
+signals:
+    /**
+     * @brief writeFinished
+     * Emitted by the writer thread after the transaction with the write is committed (or rolled back).
+     * @param writeId int the id returned by enqueue
+     * @param operation QString the operation name: "insert", "update", "upsert" or "remove"
+     * @param result int the insert id (for insert) or the number of affected rows. Zero if the write fails.
+     */
+    void writeFinished(int writeId, const QString &operation, int result);
+
+protected:
+    /**
+     * @brief run
+     * @overload
+     * The writer thread loop: wait for the queued writes and execute each group in a transaction.
+     * @return void
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief execute
+     * Execute the write in the writer thread connection
+     * @param write Write
+     * @return int the write result
+     */
+    int execute(const Write &write);
+
+private:
+    /**
+     * @brief m_instance
+     * keeps the WriteQueue instance pointer
+     */
+    static WriteQueue *m_instance;
+
+    /**
+     * @brief m_database
+     * A pointer to Database object where execute the writes.
+     */
+    Database *m_database;
+
+    /**
+     * @brief m_mutex
+     * Protect the queue and the thread state from concurrent access
+     */
+    QMutex m_mutex;
+
+    /**
+     * @brief m_queueChanged
+     * Wake up the writer thread when some write is queued, or when flush or stop is called
+     */
+    QWaitCondition m_queueChanged;
+
+    /**
+     * @brief m_queue
+     * The writes waiting to be executed
+     */
+    QQueue<Write> m_queue;
+
+    /**
+     * @brief m_counter
+     * Incremented for each queued write and used as write id
+     */
+    int m_counter;
+
+    /**
+     * @brief m_flushInterval
+     * The max time in milliseconds that a write wait in the queue. The default is 50.
+     */
+    int m_flushInterval;
+
+    /**
+     * @brief m_maxBatchRows
+     * The max number of writes executed in a single transaction. The default is 500.
+     */
+    int m_maxBatchRows;
+
+    /**
+     * @brief m_flushRequested
+     * Set by flush() and stop() to commit the queued writes without wait the flush interval
+     */
+    bool m_flushRequested;
+
+    /**
+     * @brief m_stopRequested
+     * Set by stop() to finish the writer thread after commit the queued writes
+     */
+    bool m_stopRequested;
+
+    /**
+     * @brief m_isRunning
+     * True from the enqueue that starts the writer thread until the run loop exits. Is changed only with m_mutex locked,
+     * so a write enqueued while the thread is exiting starts a new run instead of being lost.
+     */
+    bool m_isRunning;
+};
+
+#endif // WRITEQUEUE_H
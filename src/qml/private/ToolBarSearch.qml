@@ -5,7 +5,15 @@ Item {
     width: parent.width * 0.75; height: parent.height
     visible: toolBar.state === "search"
 
-    property alias searchText: __searchInput.text
+    // the text is sent to the page after the user stop typing, so the page
+    // can call DatabaseComponent.search(searchText) once, and not for each key
+    property string searchText
+
+    Timer {
+        id: __searchTimer
+        interval: 200
+        onTriggered: searchText = __searchInput.text
+    }
 
     TextField {
         id: __searchInput
@@ -16,6 +24,7 @@ Item {
         selectedTextColor: Qt.rgba(25,25,25,0.8)
         anchors.verticalCenter: parent.verticalCenter
         color: Config.theme.colorAccent
+        onTextChanged: __searchTimer.restart()
         onVisibleChanged: {
             text = ""
             if (visible)
@@ -18,8 +18,18 @@ HEADERS += src/core/filedialog.h \
     src/core/subject.h \
     src/core/utils.h \
     src/database/asyncselect.h \
+    src/database/connectionpool.h \
     src/database/database.h \
     src/database/databasecomponent.h \
+    src/database/databasemaintenance.h \
+    src/database/jsonimporter.h \
+    src/database/queryexecutor.h \
+    src/database/queryprofiler.h \
+    src/database/resultcache.h \
+    src/database/syncengine.h \
+    src/database/syncpagewriter.h \
+    src/database/tablemodel.h \
+    src/database/writequeue.h \
     src/network/downloadmanager.h \
     src/network/requesthttp.h \
     src/network/uploadmanager.h \
@@ -39,8 +49,18 @@ SOURCES += main.cpp \
     src/core/subject.cpp \
     src/core/utils.cpp \
     src/database/asyncselect.cpp \
+    src/database/connectionpool.cpp \
     src/database/database.cpp \
     src/database/databasecomponent.cpp \
+    src/database/databasemaintenance.cpp \
+    src/database/jsonimporter.cpp \
+    src/database/queryexecutor.cpp \
+    src/database/queryprofiler.cpp \
+    src/database/resultcache.cpp \
+    src/database/syncengine.cpp \
+    src/database/syncpagewriter.cpp \
+    src/database/tablemodel.cpp \
+    src/database/writequeue.cpp \
     src/network/downloadmanager.cpp \
     src/network/requesthttp.cpp \
     src/network/uploadmanager.cpp \